@@ -8,10 +8,13 @@
 #include "ConsumerIr.h"
 
 #include <android-base/logging.h>
-#include <fcntl.h>
-#include <linux/lirc.h>
+#include <android-base/properties.h>
+#include <chrono>
 #include <string>
+#include "LircDevice.h"
 
+using ::android::base::GetBoolProperty;
+using ::android::base::GetProperty;
 using std::vector;
 
 namespace aidl {
@@ -20,11 +23,20 @@ namespace hardware {
 namespace ir {
 
 static const std::string kIrDevice = "/dev/lirc0";
+static const std::string kIrDeviceProp = "vendor.ir.device";
+static const std::string kAsyncTransmitProp = "vendor.ir.async_transmit";
 
 static vector<ConsumerIrFreqRange> kRangeVec{
         {.minHz = 30000, .maxHz = 60000},
 };
 
+ConsumerIr::ConsumerIr()
+    : ConsumerIr(std::make_unique<LircDevice>(GetProperty(kIrDeviceProp, kIrDevice))) {}
+
+ConsumerIr::ConsumerIr(std::unique_ptr<ILircDevice> device)
+    : mAsyncTransmit(GetBoolProperty(kAsyncTransmitProp, false)),
+      mTransmitter(std::move(device)) {}
+
 ::ndk::ScopedAStatus ConsumerIr::getCarrierFreqs(vector<ConsumerIrFreqRange>* _aidl_return) {
     *_aidl_return = kRangeVec;
 
@@ -32,46 +44,38 @@ static vector<ConsumerIrFreqRange> kRangeVec{
 }
 
 ::ndk::ScopedAStatus ConsumerIr::transmit(int32_t carrierFreqHz, const vector<int32_t>& pattern) {
-    size_t entries = pattern.size();
-
-    if (entries == 0) {
+    if (pattern.empty()) {
         return ::ndk::ScopedAStatus::ok();
     }
 
-    int fd = open(kIrDevice.c_str(), O_RDWR);
-    if (fd < 0) {
-        LOG(ERROR) << "Failed to open " << kIrDevice << ", error " << fd;
-
-        return ::ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
-    }
-
-    int rc = ioctl(fd, LIRC_SET_SEND_CARRIER, &carrierFreqHz);
-    if (rc < 0) {
-        LOG(ERROR) << "Failed to set carrier " << carrierFreqHz << ", error: " << errno;
-
-        close(fd);
-
-        return ::ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+    std::future<LircTransmitter::Result> result = mTransmitter.transmit(carrierFreqHz, pattern);
+    if (mAsyncTransmit && result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return ::ndk::ScopedAStatus::ok();
     }
 
-    if ((entries & 1) != 0) {
-        rc = write(fd, pattern.data(), entries * sizeof(int32_t));
-    } else {
-        rc = write(fd, pattern.data(), (entries - 1) * sizeof(int32_t));
-        usleep(pattern[entries - 1]);
+    switch (result.get()) {
+        case LircTransmitter::Result::OK:
+            return ::ndk::ScopedAStatus::ok();
+        case LircTransmitter::Result::INVALID_PATTERN:
+            return ::ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+        case LircTransmitter::Result::CARRIER_FAILED:
+            return ::ndk::ScopedAStatus::fromExceptionCode(EX_UNSUPPORTED_OPERATION);
+        case LircTransmitter::Result::OPEN_FAILED:
+        case LircTransmitter::Result::WRITE_FAILED:
+            break;
     }
 
-    if (rc < 0) {
-        LOG(ERROR) << "Failed to write pattern, " << entries << " entries, error: " << errno;
-
-        close(fd);
+    return ::ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
+}
 
-        return ::ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_STATE);
-    }
+binder_status_t ConsumerIr::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/) {
+    dprintf(fd, "ConsumerIr AIDL:\n");
+    dprintf(fd, "\n");
 
-    close(fd);
+    dprintf(fd, "Async transmit: %d\n", mAsyncTransmit);
+    mTransmitter.dump(fd);
 
-    return ::ndk::ScopedAStatus::ok();
+    return STATUS_OK;
 }
 
 }  // namespace ir
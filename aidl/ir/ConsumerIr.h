@@ -6,6 +6,9 @@
 #pragma once
 
 #include <aidl/android/hardware/ir/BnConsumerIr.h>
+#include <memory>
+#include "ILircDevice.h"
+#include "LircTransmitter.h"
 
 namespace aidl {
 namespace android {
@@ -14,11 +17,30 @@ namespace ir {
 
 class ConsumerIr : public BnConsumerIr {
   public:
+    ConsumerIr();
+
+    /**
+     * Constructor.
+     *
+     * @param device The LIRC device to transmit through
+     */
+    ConsumerIr(std::unique_ptr<ILircDevice> device);
+
     ::ndk::ScopedAStatus getCarrierFreqs(
             ::std::vector<::aidl::android::hardware::ir::ConsumerIrFreqRange>* _aidl_return)
             override;
     ::ndk::ScopedAStatus transmit(int32_t carrierFreqHz,
                                   const ::std::vector<int32_t>& pattern) override;
+
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+  private:
+    // Don't wait for patterns to be written, opt-in with vendor.ir.async_transmit as
+    // IConsumerIr.transmit is meant to return once the pattern was sent. Invalid patterns are
+    // still rejected, device errors are only logged. Needed for repeated patterns to be coalesced
+    // when the client only transmits after the previous call returned.
+    const bool mAsyncTransmit;
+    LircTransmitter mTransmitter;
 };
 
 }  // namespace ir
@@ -0,0 +1,64 @@
+/*
+ * SPDX-FileCopyrightText: 2024 The LineageOS Project
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <cstdint>
+#include <string>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace ir {
+
+/**
+ * Operations on a LIRC device, following the semantics of the character device.
+ * Failures return -1 and set errno.
+ */
+class ILircDevice {
+  public:
+    virtual ~ILircDevice() = default;
+
+    /**
+     * @return std::string The path of the device, for logging
+     */
+    virtual std::string getPath() const = 0;
+
+    /**
+     * Open the device, closing it first if it's already open.
+     */
+    virtual int open() = 0;
+
+    /**
+     * Close the device, a no-op if it isn't open.
+     */
+    virtual void close() = 0;
+
+    /**
+     * @return bool Whether the device is open
+     */
+    virtual bool isOpen() const = 0;
+
+    /**
+     * Issue a LIRC ioctl taking a 32-bit argument, e.g. LIRC_SET_SEND_CARRIER.
+     */
+    virtual int ioctl(unsigned long request, uint32_t* arg) = 0;
+
+    /**
+     * Transmit pulses and spaces, blocks until they have been sent.
+     *
+     * @param timings Alternating pulse and space durations in microseconds, starting and
+     *                ending with a pulse
+     * @param entries The number of timings
+     * @return ssize_t The number of bytes written
+     */
+    virtual ssize_t write(const int32_t* timings, size_t entries) = 0;
+};
+
+}  // namespace ir
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
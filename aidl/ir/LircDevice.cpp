@@ -0,0 +1,47 @@
+/*
+ * SPDX-FileCopyrightText: 2024 The LineageOS Project
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "LircDevice.h"
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace ir {
+
+LircDevice::LircDevice(std::string path) : mPath(path) {}
+
+std::string LircDevice::getPath() const {
+    return mPath;
+}
+
+int LircDevice::open() {
+    mFd.reset(TEMP_FAILURE_RETRY(::open(mPath.c_str(), O_RDWR | O_CLOEXEC)));
+    return mFd < 0 ? -1 : 0;
+}
+
+void LircDevice::close() {
+    mFd.reset();
+}
+
+bool LircDevice::isOpen() const {
+    return mFd >= 0;
+}
+
+int LircDevice::ioctl(unsigned long request, uint32_t* arg) {
+    return ::ioctl(mFd, request, arg);
+}
+
+ssize_t LircDevice::write(const int32_t* timings, size_t entries) {
+    return TEMP_FAILURE_RETRY(::write(mFd, timings, entries * sizeof(int32_t)));
+}
+
+}  // namespace ir
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
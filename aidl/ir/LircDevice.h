@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: 2024 The LineageOS Project
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <string>
+#include "ILircDevice.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace ir {
+
+/**
+ * A LIRC character device, e.g. /dev/lirc0.
+ */
+class LircDevice : public ILircDevice {
+  public:
+    LircDevice(std::string path);
+
+    std::string getPath() const override;
+    int open() override;
+    void close() override;
+    bool isOpen() const override;
+    int ioctl(unsigned long request, uint32_t* arg) override;
+    ssize_t write(const int32_t* timings, size_t entries) override;
+
+  private:
+    const std::string mPath;
+    ::android::base::unique_fd mFd;
+};
+
+}  // namespace ir
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
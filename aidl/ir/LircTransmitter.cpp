@@ -0,0 +1,258 @@
+/*
+ * SPDX-FileCopyrightText: 2024 The LineageOS Project
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "LircTransmitter"
+
+#include "LircTransmitter.h"
+
+#include <android-base/logging.h>
+#include <inttypes.h>
+#include <linux/lirc.h>
+#include <stdio.h>
+#include <algorithm>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace ir {
+
+// Transmits are a few hundred bytes at most, this only bounds misbehaving clients
+static constexpr size_t kMaxQueuedTransmits = 16;
+static constexpr size_t kPatternCacheSize = 8;
+
+// Limits enforced by the kernel on a single write, see ir_lirc_transmit_ir()
+static constexpr size_t kLircMaxEntries = 1024;        // LIRCBUF_SIZE
+static constexpr int64_t kLircMaxDurationUs = 500000;  // IR_MAX_DURATION
+
+static size_t hashTimings(const std::vector<int32_t>& timings) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (int32_t timing : timings) {
+        hash ^= static_cast<uint32_t>(timing);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+LircTransmitter::LircTransmitter(std::unique_ptr<ILircDevice> device)
+    : mExiting(false),
+      mDevice(std::move(device)),
+      mTransmitCount(0),
+      mPatternCacheHitCount(0),
+      mInvalidPatternCount(0),
+      mCoalescedTransmitCount(0),
+      mWriteCount(0),
+      mErrorCount(0),
+      mThread(&LircTransmitter::threadLoop, this) {}
+
+LircTransmitter::~LircTransmitter() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExiting = true;
+    }
+    mCondition.notify_all();
+    mThread.join();
+}
+
+std::future<LircTransmitter::Result> LircTransmitter::transmit(int32_t carrierFreqHz,
+                                                               std::vector<int32_t> pattern) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mTransmitCount++;
+
+    std::shared_ptr<const Pattern> cached = getPattern(std::move(pattern));
+    if (!cached->valid) {
+        lock.unlock();
+        LOG(ERROR) << "Pattern exceeds LIRC limits, " << cached->timings.size() << " entries";
+        mInvalidPatternCount++;
+        std::promise<Result> invalid;
+        invalid.set_value(Result::INVALID_PATTERN);
+        return invalid.get_future();
+    }
+
+    mCondition.wait(lock, [this] { return mQueue.size() < kMaxQueuedTransmits; });
+    mQueue.push_back({
+            .carrierFreqHz = carrierFreqHz,
+            .pattern = std::move(cached),
+            .result = {},
+    });
+    std::future<Result> result = mQueue.back().result.get_future();
+
+    lock.unlock();
+    mCondition.notify_all();
+
+    return result;
+}
+
+std::shared_ptr<const LircTransmitter::Pattern> LircTransmitter::getPattern(
+        std::vector<int32_t> timings) {
+    const size_t hash = hashTimings(timings);
+
+    for (auto it = mPatternCache.begin(); it != mPatternCache.end(); it++) {
+        if ((*it)->hash == hash && (*it)->timings == timings) {
+            mPatternCacheHitCount++;
+            mPatternCache.splice(mPatternCache.begin(), mPatternCache, it);
+            return mPatternCache.front();
+        }
+    }
+
+    // The trailing space isn't written, see send()
+    const size_t entries = timings.size() - (timings.size() % 2 == 0 ? 1 : 0);
+
+    bool valid = entries <= kLircMaxEntries;
+    int64_t durationUs = 0;
+    for (size_t i = 0; i < entries && valid; i++) {
+        durationUs += timings[i];
+        valid = timings[i] > 0 && durationUs <= kLircMaxDurationUs;
+    }
+
+    // Copies are separated by the trailing space, which must then be writable too
+    const bool repeatable = valid && entries < timings.size() && timings.back() > 0 &&
+                            durationUs + timings.back() <= kLircMaxDurationUs;
+
+    auto pattern = std::make_shared<const Pattern>(Pattern{
+            .timings = std::move(timings),
+            .hash = hash,
+            .valid = valid,
+            .repeatable = repeatable,
+    });
+
+    mPatternCache.push_front(pattern);
+    if (mPatternCache.size() > kPatternCacheSize) {
+        mPatternCache.pop_back();
+    }
+
+    return pattern;
+}
+
+void LircTransmitter::threadLoop() {
+    while (true) {
+        std::vector<Request> requests;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mExiting || !mQueue.empty(); });
+            if (mQueue.empty()) {
+                return;
+            }
+
+            requests.push_back(std::move(mQueue.front()));
+            mQueue.pop_front();
+            // Wake up callers waiting for room in the queue
+            mCondition.notify_all();
+
+            // Coalesce copies of the pattern queued until the device is idle again, as long as
+            // the kernel accepts them in a single write. The write would have to wait for the
+            // trailing space of the previous one anyway, so this adds no latency.
+            const Request& first = requests.front();
+            const Pattern& pattern = *first.pattern;
+            if (pattern.repeatable) {
+                mCondition.wait_until(lock, mIdleTime, [this] {
+                    return mExiting || mQueue.size() >= kMaxQueuedTransmits;
+                });
+
+                const size_t patternEntries = pattern.timings.size();
+                int64_t patternDurationUs = 0;
+                for (int32_t timing : pattern.timings) {
+                    patternDurationUs += timing;
+                }
+
+                size_t entries = patternEntries;
+                int64_t durationUs = patternDurationUs;
+                while (!mQueue.empty() && mQueue.front().pattern == first.pattern &&
+                       mQueue.front().carrierFreqHz == first.carrierFreqHz &&
+                       entries + patternEntries - 1 <= kLircMaxEntries &&
+                       durationUs + patternDurationUs - pattern.timings.back() <=
+                               kLircMaxDurationUs) {
+                    requests.push_back(std::move(mQueue.front()));
+                    mQueue.pop_front();
+                    entries += patternEntries;
+                    durationUs += patternDurationUs;
+                }
+            }
+        }
+        mCondition.notify_all();
+
+        const Request& first = requests.front();
+        Result result;
+        if (requests.size() == 1) {
+            result = send(first.carrierFreqHz, first.pattern->timings);
+        } else {
+            std::vector<int32_t> timings;
+            timings.reserve(first.pattern->timings.size() * requests.size());
+            for (size_t i = 0; i < requests.size(); i++) {
+                timings.insert(timings.end(), first.pattern->timings.begin(),
+                               first.pattern->timings.end());
+            }
+            mCoalescedTransmitCount += requests.size() - 1;
+            result = send(first.carrierFreqHz, timings);
+        }
+
+        for (auto& request : requests) {
+            request.result.set_value(result);
+        }
+    }
+}
+
+LircTransmitter::Result LircTransmitter::send(int32_t carrierFreqHz,
+                                              const std::vector<int32_t>& timings) {
+    size_t entries = timings.size();
+
+    if (!mDevice->isOpen()) {
+        if (mDevice->open() < 0) {
+            PLOG(ERROR) << "Failed to open " << mDevice->getPath();
+            mErrorCount++;
+            return Result::OPEN_FAILED;
+        }
+        mCarrierFreqHz.reset();
+    }
+
+    if (mCarrierFreqHz != carrierFreqHz) {
+        uint32_t carrier = carrierFreqHz;
+        if (mDevice->ioctl(LIRC_SET_SEND_CARRIER, &carrier) < 0) {
+            PLOG(ERROR) << "Failed to set carrier " << carrierFreqHz;
+            mErrorCount++;
+            mCarrierFreqHz.reset();
+            return Result::CARRIER_FAILED;
+        }
+        mCarrierFreqHz = carrierFreqHz;
+    }
+
+    // The trailing space of the previous pattern must have elapsed
+    std::this_thread::sleep_until(mIdleTime);
+
+    // LIRC patterns must end with a pulse, the trailing space is kept as a deadline instead
+    std::chrono::microseconds trailingSpace(0);
+    if ((entries & 1) == 0) {
+        entries--;
+        trailingSpace = std::chrono::microseconds(timings[entries]);
+    }
+
+    ssize_t rc = mDevice->write(timings.data(), entries);
+    mIdleTime = Clock::now() + trailingSpace;
+    mWriteCount++;
+    if (rc < 0) {
+        PLOG(ERROR) << "Failed to write pattern, " << entries << " entries";
+        mErrorCount++;
+        // Reopen the device on the next transmit
+        mDevice->close();
+        return Result::WRITE_FAILED;
+    }
+
+    return Result::OK;
+}
+
+void LircTransmitter::dump(int fd) const {
+    dprintf(fd, "Device: %s\n", mDevice->getPath().c_str());
+    dprintf(fd, "Transmits: %" PRIu64 "\n", mTransmitCount.load());
+    dprintf(fd, "Pattern cache hits: %" PRIu64 "\n", mPatternCacheHitCount.load());
+    dprintf(fd, "Invalid patterns: %" PRIu64 "\n", mInvalidPatternCount.load());
+    dprintf(fd, "Coalesced transmits: %" PRIu64 "\n", mCoalescedTransmitCount.load());
+    dprintf(fd, "Writes: %" PRIu64 "\n", mWriteCount.load());
+    dprintf(fd, "Errors: %" PRIu64 "\n", mErrorCount.load());
+}
+
+}  // namespace ir
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
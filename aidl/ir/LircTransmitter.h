@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: 2024 The LineageOS Project
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ILircDevice.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace ir {
+
+/**
+ * Transmits IR patterns through a LIRC device from a dedicated thread.
+ *
+ * The device is kept open across transmits and the carrier frequency is only set when it
+ * changes. A trailing space in a pattern isn't slept through, it only delays the start of the
+ * next transmit.
+ *
+ * Recently transmitted patterns are cached by content, so that repeated patterns, e.g. a held
+ * key, are only validated once. Patterns exceeding the LIRC limits are rejected without being
+ * queued. Identical patterns queued back to back until the trailing space of the previous write
+ * has elapsed are coalesced into a single write, separated by their trailing spaces. This only
+ * happens when callers don't wait for the result of a transmit before queueing the next one.
+ */
+class LircTransmitter {
+  public:
+    enum class Result {
+        OK,
+        INVALID_PATTERN,
+        OPEN_FAILED,
+        CARRIER_FAILED,
+        WRITE_FAILED,
+    };
+
+    LircTransmitter(std::unique_ptr<ILircDevice> device);
+    ~LircTransmitter();
+
+    /**
+     * Queue a pattern for transmission.
+     * Blocks while the queue is full.
+     *
+     * @param carrierFreqHz The carrier frequency
+     * @param pattern Alternating pulse and space durations, in microseconds
+     * @return std::future<Result> Becomes ready once the pattern has been written, already
+     *         ready with Result::INVALID_PATTERN if the pattern exceeds the LIRC limits
+     */
+    std::future<Result> transmit(int32_t carrierFreqHz, std::vector<int32_t> pattern);
+
+    /**
+     * Write transmit statistics to the given file descriptor using dprintf().
+     *
+     * @param fd The file descriptor to write to
+     */
+    void dump(int fd) const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pattern {
+        std::vector<int32_t> timings;
+        size_t hash;
+        // Whether the pattern is within the LIRC limits
+        bool valid;
+        // Whether copies of the pattern can follow it in the same write
+        bool repeatable;
+    };
+
+    struct Request {
+        int32_t carrierFreqHz;
+        std::shared_ptr<const Pattern> pattern;
+        std::promise<Result> result;
+    };
+
+    std::shared_ptr<const Pattern> getPattern(std::vector<int32_t> timings);
+    void threadLoop();
+    Result send(int32_t carrierFreqHz, const std::vector<int32_t>& timings);
+
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Request> mQueue;
+    // Most recently used first
+    std::list<std::shared_ptr<const Pattern>> mPatternCache;
+    bool mExiting;
+
+    // Only used from the transmit thread
+    const std::unique_ptr<ILircDevice> mDevice;
+    std::optional<int32_t> mCarrierFreqHz;
+    Clock::time_point mIdleTime;
+
+    std::atomic<uint64_t> mTransmitCount;
+    std::atomic<uint64_t> mPatternCacheHitCount;
+    std::atomic<uint64_t> mInvalidPatternCount;
+    std::atomic<uint64_t> mCoalescedTransmitCount;
+    std::atomic<uint64_t> mWriteCount;
+    std::atomic<uint64_t> mErrorCount;
+
+    std::thread mThread;
+};
+
+}  // namespace ir
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,130 @@
+/*
+ * SPDX-FileCopyrightText: 2024 The LineageOS Project
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <errno.h>
+#include <linux/lirc.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "ILircDevice.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace ir {
+
+/**
+ * Stands in for a LIRC device on a host, following what ir_lirc_transmit_ir() and
+ * lirc_ioctl() accept for a transmitter with a settable carrier.
+ */
+class FakeLircDevice : public ILircDevice {
+  public:
+    /**
+     * Constructor.
+     *
+     * @param realTime Whether writes block for the duration of the pattern, like the kernel
+     */
+    FakeLircDevice(bool realTime)
+        : mRealTime(realTime),
+          mOpen(false),
+          mCarrierFreqHz(0),
+          mCarrierSetCount(0),
+          mWriteCount(0),
+          mWrittenEntryCount(0) {}
+
+    std::string getPath() const override { return "fake-lirc"; }
+
+    int open() override {
+        mOpen = true;
+        return 0;
+    }
+
+    void close() override { mOpen = false; }
+
+    bool isOpen() const override { return mOpen; }
+
+    int ioctl(unsigned long request, uint32_t* arg) override {
+        if (!mOpen) {
+            errno = EBADF;
+            return -1;
+        }
+
+        switch (request) {
+            case LIRC_GET_FEATURES:
+                *arg = LIRC_CAN_SEND_PULSE | LIRC_CAN_SET_SEND_CARRIER;
+                return 0;
+            case LIRC_GET_SEND_MODE:
+                *arg = LIRC_MODE_PULSE;
+                return 0;
+            case LIRC_SET_SEND_CARRIER:
+                if (*arg == 0) {
+                    errno = EINVAL;
+                    return -1;
+                }
+                mCarrierFreqHz = *arg;
+                mCarrierSetCount++;
+                return 0;
+            default:
+                errno = ENOTTY;
+                return -1;
+        }
+    }
+
+    ssize_t write(const int32_t* timings, size_t entries) override {
+        if (!mOpen) {
+            errno = EBADF;
+            return -1;
+        }
+
+        // An odd number of entries, at most LIRCBUF_SIZE, lasting at most IR_MAX_DURATION
+        if (entries % 2 == 0 || entries > kMaxEntries) {
+            errno = EINVAL;
+            return -1;
+        }
+        int64_t durationUs = 0;
+        for (size_t i = 0; i < entries; i++) {
+            durationUs += timings[i];
+            if (timings[i] <= 0 || durationUs > kMaxDurationUs) {
+                errno = EINVAL;
+                return -1;
+            }
+        }
+
+        if (mRealTime) {
+            std::this_thread::sleep_for(std::chrono::microseconds(durationUs));
+        }
+
+        mWriteCount++;
+        mWrittenEntryCount += entries;
+        return entries * sizeof(int32_t);
+    }
+
+    uint32_t getCarrierFreqHz() const { return mCarrierFreqHz; }
+    uint64_t getCarrierSetCount() const { return mCarrierSetCount; }
+    uint64_t getWriteCount() const { return mWriteCount; }
+    uint64_t getWrittenEntryCount() const { return mWrittenEntryCount; }
+
+  private:
+    static constexpr size_t kMaxEntries = 1024;
+    static constexpr int64_t kMaxDurationUs = 500000;
+
+    const bool mRealTime;
+    bool mOpen;
+
+    // Read from the benchmark thread
+    std::atomic<uint32_t> mCarrierFreqHz;
+    std::atomic<uint64_t> mCarrierSetCount;
+    std::atomic<uint64_t> mWriteCount;
+    std::atomic<uint64_t> mWrittenEntryCount;
+};
+
+}  // namespace ir
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,146 @@
+/*
+ * SPDX-FileCopyrightText: 2024 The LineageOS Project
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+#include "FakeLircDevice.h"
+#include "LircTransmitter.h"
+
+using aidl::android::hardware::ir::FakeLircDevice;
+using aidl::android::hardware::ir::LircTransmitter;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int32_t kCarrierFreqHz = 38000;
+
+// Transmits queued by the async benchmarks before waiting for them
+constexpr int kBatchSize = 16;
+
+// Repeat frames sent while a key is held
+constexpr int kHeldKeyRepeats = 16;
+
+// NEC repeat frame, 3 entries
+std::vector<int32_t> shortPattern() {
+    return {9000, 2250, 560};
+}
+
+// 112-bit air conditioner frame, 227 entries
+std::vector<int32_t> longPattern() {
+    std::vector<int32_t> pattern = {3500, 1750};
+    for (int bit = 0; bit < 112; bit++) {
+        pattern.push_back(560);
+        pattern.push_back(bit % 3 == 0 ? 1690 : 560);
+    }
+    pattern.push_back(560);
+    return pattern;
+}
+
+std::vector<int32_t> getPattern(int64_t kind) {
+    return kind == 0 ? shortPattern() : longPattern();
+}
+
+LircTransmitter::Result checkResult(LircTransmitter::Result result, benchmark::State& state) {
+    if (result != LircTransmitter::Result::OK) {
+        state.SkipWithError("Transmit failed");
+    }
+    return result;
+}
+
+/*
+ * Synchronous transmits of a short (0) or long (1) pattern to a device writing instantly, i.e.
+ * the latency added by the HAL on top of the transmission itself.
+ */
+void BM_LircTransmitter_Sync(benchmark::State& state) {
+    const std::vector<int32_t> pattern = getPattern(state.range(0));
+    auto device = std::make_unique<FakeLircDevice>(false);
+    FakeLircDevice* fake = device.get();
+    LircTransmitter transmitter(std::move(device));
+
+    for (auto _ : state) {
+        checkResult(transmitter.transmit(kCarrierFreqHz, pattern).get(), state);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["carrier_sets"] = fake->getCarrierSetCount();
+}
+BENCHMARK(BM_LircTransmitter_Sync)->ArgName("long")->Arg(0)->Arg(1)->UseRealTime();
+
+/*
+ * Batches of transmits queued without waiting for each of them, i.e. the throughput of the
+ * HAL with vendor.ir.async_transmit.
+ */
+void BM_LircTransmitter_Async(benchmark::State& state) {
+    const std::vector<int32_t> pattern = getPattern(state.range(0));
+    LircTransmitter transmitter(std::make_unique<FakeLircDevice>(false));
+
+    std::vector<std::future<LircTransmitter::Result>> results;
+    results.reserve(kBatchSize);
+    for (auto _ : state) {
+        for (int i = 0; i < kBatchSize; i++) {
+            results.push_back(transmitter.transmit(kCarrierFreqHz, pattern));
+        }
+        for (auto& result : results) {
+            checkResult(result.get(), state);
+        }
+        results.clear();
+    }
+
+    state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+BENCHMARK(BM_LircTransmitter_Async)->ArgName("long")->Arg(0)->Arg(1)->UseRealTime();
+
+/*
+ * A held key, sending NEC repeat frames with their 96ms trailing space to a device blocking for
+ * the duration of each write, either waiting for each transmit (0) or not (1). Reports writes per
+ * transmit, which coalescing brings down, and the time spent in transmit(), which is what the
+ * binder thread pays.
+ */
+void BM_LircTransmitter_HeldKey(benchmark::State& state) {
+    const bool async = state.range(0);
+    const std::vector<int32_t> pattern = {9000, 2250, 560, 96190};
+    auto device = std::make_unique<FakeLircDevice>(true);
+    FakeLircDevice* fake = device.get();
+    LircTransmitter transmitter(std::move(device));
+
+    const uint64_t startWrites = fake->getWriteCount();
+    Clock::duration callTime{0};
+    std::vector<std::future<LircTransmitter::Result>> results;
+    for (auto _ : state) {
+        for (int i = 0; i < kHeldKeyRepeats; i++) {
+            const Clock::time_point start = Clock::now();
+            results.push_back(transmitter.transmit(kCarrierFreqHz, pattern));
+            if (!async) {
+                checkResult(results.back().get(), state);
+                results.pop_back();
+            }
+            callTime += Clock::now() - start;
+        }
+        for (auto& result : results) {
+            checkResult(result.get(), state);
+        }
+        results.clear();
+    }
+
+    const double transmits = state.iterations() * kHeldKeyRepeats;
+    state.counters["writes_per_transmit"] = (fake->getWriteCount() - startWrites) / transmits;
+    state.counters["call_us"] =
+            std::chrono::duration<double, std::micro>(callTime).count() / transmits;
+}
+BENCHMARK(BM_LircTransmitter_HeldKey)
+        ->ArgName("async")
+        ->Arg(0)
+        ->Arg(1)
+        ->Iterations(2)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -9,7 +9,8 @@
 #define LOG_TAG "BacklightDevice"
 
 #include <android-base/logging.h>
-#include <fstream>
+#include <algorithm>
+#include <set>
 #include "Utils.h"
 
 namespace aidl {
@@ -17,15 +18,21 @@ namespace android {
 namespace hardware {
 namespace light {
 
-static const std::string kBacklightBasePath = "/sys/class/backlight/";
 static const uint32_t kDefaultMaxBrightness = 255;
 
 static const std::string kBrightnessNode = "brightness";
 static const std::string kMaxBrightnessNode = "max_brightness";
 
-BacklightDevice::BacklightDevice(std::string name)
-    : mName(name), mBasePath(kBacklightBasePath + name + "/") {
-    if (!readFromFile(mBasePath + kMaxBrightnessNode, mMaxBrightness)) {
+BacklightDevice::BacklightDevice(std::string name, std::string classPath)
+    : mName(name),
+      mBasePath(classPath + name + "/"),
+      mExists(false),
+      mBrightnessNode(mBasePath + kBrightnessNode) {
+    const std::set<std::string> nodes = listFiles(mBasePath);
+    mExists = nodes.count(kBrightnessNode) > 0;
+
+    if (nodes.count(kMaxBrightnessNode) == 0 ||
+        !readFromFile(mBasePath + kMaxBrightnessNode, mMaxBrightness)) {
         mMaxBrightness = kDefaultMaxBrightness;
     }
 };
@@ -35,11 +42,19 @@ std::string BacklightDevice::getName() const {
 }
 
 bool BacklightDevice::exists() const {
-    return std::ifstream(mBasePath + kBrightnessNode).good();
+    return mExists;
 }
 
 bool BacklightDevice::setBrightness(uint8_t value) {
-    return writeToFile(mBasePath + kBrightnessNode, scaleBrightness(value, mMaxBrightness));
+    return mBrightnessNode.write(scaleBrightness(value, mMaxBrightness));
+}
+
+uint32_t BacklightDevice::getMaxBrightness() const {
+    return mMaxBrightness;
+}
+
+bool BacklightDevice::setRawBrightness(uint32_t value) {
+    return mBrightnessNode.write(std::min(value, mMaxBrightness));
 }
 
 void BacklightDevice::dump(int fd) const {
@@ -47,6 +62,8 @@ void BacklightDevice::dump(int fd) const {
     dprintf(fd, ", exists: %d", exists());
     dprintf(fd, ", base path: %s", mBasePath.c_str());
     dprintf(fd, ", max brightness: %u", mMaxBrightness);
+    dprintf(fd, "\n  - %s: ", kBrightnessNode.c_str());
+    mBrightnessNode.dump(fd);
 }
 
 }  // namespace light
@@ -9,6 +9,7 @@
 #include <cstdint>
 #include <string>
 #include "IDumpable.h"
+#include "SysfsNode.h"
 
 namespace aidl {
 namespace android {
@@ -27,8 +28,9 @@ class BacklightDevice : public IDumpable {
      * Constructor.
      *
      * @param name The name of the backlight device
+     * @param classPath The directory holding the backlight devices
      */
-    BacklightDevice(std::string name);
+    BacklightDevice(std::string name, std::string classPath = "/sys/class/backlight/");
 
     /**
      * Get the name of the backlight device.
@@ -39,6 +41,7 @@ class BacklightDevice : public IDumpable {
 
     /**
      * Return whether this backlight device exists.
+     * This is probed once, when the backlight device is created.
      *
      * @return bool true if the backlight device exists, false otherwise
      */
@@ -52,12 +55,30 @@ class BacklightDevice : public IDumpable {
      */
     bool setBrightness(uint8_t value);
 
+    /**
+     * Get the maximum brightness of this backlight device, in its native units.
+     *
+     * @return uint32_t The maximum brightness
+     */
+    uint32_t getMaxBrightness() const;
+
+    /**
+     * Set the brightness of this backlight device in its native units, bypassing the 8-bit
+     * scaling. Used to ramp the backlight at the full resolution of the panel.
+     *
+     * @param value The brightness value to set, clamped to getMaxBrightness()
+     * @return bool true if the brightness was set successfully, false otherwise
+     */
+    bool setRawBrightness(uint32_t value);
+
     void dump(int fd) const override;
 
   private:
     std::string mName;
     std::string mBasePath;
+    bool mExists;
     uint32_t mMaxBrightness;
+    SysfsNode mBrightnessNode;
 };
 
 }  // namespace light
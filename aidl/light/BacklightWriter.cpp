@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "BacklightWriter.h"
+
+#define LOG_TAG "BacklightWriter"
+
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <algorithm>
+#include <cmath>
+
+using ::android::base::GetProperty;
+using ::android::base::GetUintProperty;
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+
+static const std::string kRampDurationProp = "vendor.light.backlight.ramp_duration_ms";
+static const std::string kRampCurveProp = "vendor.light.backlight.ramp_curve";
+
+// Don't step faster than this, even if the panel has more levels than that to go through
+static constexpr auto kMinRampInterval = std::chrono::milliseconds(4);
+
+static BacklightWriter::RampCurve getRampCurve() {
+    const std::string curve = GetProperty(kRampCurveProp, "linear");
+
+    if (curve == "ease_out") {
+        return BacklightWriter::RampCurve::EASE_OUT;
+    } else if (curve == "ease_in_out") {
+        return BacklightWriter::RampCurve::EASE_IN_OUT;
+    } else if (curve != "linear") {
+        LOG(ERROR) << "Unknown ramp curve: " << curve << ", using linear";
+    }
+
+    return BacklightWriter::RampCurve::LINEAR;
+}
+
+static const char* toString(BacklightWriter::RampCurve curve) {
+    switch (curve) {
+        case BacklightWriter::RampCurve::LINEAR:
+            return "linear";
+        case BacklightWriter::RampCurve::EASE_OUT:
+            return "ease_out";
+        case BacklightWriter::RampCurve::EASE_IN_OUT:
+            return "ease_in_out";
+    }
+
+    return "unknown";
+}
+
+static double applyRampCurve(BacklightWriter::RampCurve curve, double progress) {
+    switch (curve) {
+        case BacklightWriter::RampCurve::LINEAR:
+            return progress;
+        case BacklightWriter::RampCurve::EASE_OUT:
+            return 1 - (1 - progress) * (1 - progress);
+        case BacklightWriter::RampCurve::EASE_IN_OUT:
+            return progress * progress * (3 - 2 * progress);
+    }
+
+    return progress;
+}
+
+BacklightWriter::BacklightWriter(Devices& devices)
+    : BacklightWriter(devices,
+                      std::chrono::milliseconds(GetUintProperty<uint32_t>(kRampDurationProp, 0)),
+                      getRampCurve()) {}
+
+BacklightWriter::BacklightWriter(Devices& devices, std::chrono::milliseconds rampDuration,
+                                 RampCurve rampCurve)
+    : mDevices(devices),
+      mMaxBrightness(devices.getBacklightMaxBrightness()),
+      mRampDuration(rampDuration),
+      mRampCurve(rampCurve),
+      mEventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      mTimerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)),
+      mSynchronous(mEventFd < 0 || mTimerFd < 0),
+      mExiting(false),
+      mRampStart(0),
+      mRampTarget(0),
+      mRequestCount(0),
+      mWriteCount(0),
+      mCoalescedCount(0),
+      mRampCount(0) {
+    if (mSynchronous) {
+        // Without them the thread would never wake up, write from post() instead
+        PLOG(ERROR) << "Failed to create backlight writer fds, writing synchronously";
+        return;
+    }
+
+    mThread = std::thread(&BacklightWriter::threadLoop, this);
+}
+
+BacklightWriter::~BacklightWriter() {
+    if (mSynchronous) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExiting = true;
+    }
+    eventfd_write(mEventFd, 1);
+    mThread.join();
+}
+
+void BacklightWriter::post(rgb color) {
+    mRequestCount++;
+
+    if (mSynchronous) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        apply(color);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mPendingColor) {
+            mCoalescedCount++;
+        }
+        mPendingColor = color;
+    }
+    eventfd_write(mEventFd, 1);
+}
+
+void BacklightWriter::threadLoop() {
+    struct pollfd fds[] = {
+            {.fd = mEventFd, .events = POLLIN},
+            {.fd = mTimerFd, .events = POLLIN},
+    };
+
+    while (true) {
+        if (TEMP_FAILURE_RETRY(poll(fds, std::size(fds), -1)) < 0) {
+            PLOG(ERROR) << "Failed to poll";
+            return;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            eventfd_t value;
+            eventfd_read(mEventFd, &value);
+
+            std::optional<rgb> color;
+            bool exiting;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                color = mPendingColor;
+                mPendingColor.reset();
+                exiting = mExiting;
+            }
+
+            // Flush the last color before exiting
+            if (color) {
+                apply(*color);
+            }
+            if (exiting) {
+                return;
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            uint64_t expirations;
+            if (read(mTimerFd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                stepRamp();
+            }
+        }
+    }
+}
+
+void BacklightWriter::apply(rgb color) {
+    const uint32_t target = scaleBrightness(color.toBrightness(), mMaxBrightness);
+
+    // Ramps are driven from the writer thread
+    if (mRampDuration.count() == 0 || mSynchronous || !mCurrentBrightness ||
+        *mCurrentBrightness == 0 || target == 0) {
+        setTimer(std::chrono::nanoseconds::zero());
+        mDevices.setBacklightColor(color);
+        mWriteCount++;
+        mCurrentBrightness = target;
+        return;
+    }
+
+    startRamp(target);
+}
+
+void BacklightWriter::startRamp(uint32_t target) {
+    // Restart from wherever a running ramp got to
+    mRampStart = *mCurrentBrightness;
+    mRampTarget = target;
+    mRampStartTime = Clock::now();
+
+    const uint32_t steps = std::max(mRampStart, mRampTarget) - std::min(mRampStart, mRampTarget);
+    if (steps == 0) {
+        setTimer(std::chrono::nanoseconds::zero());
+        return;
+    }
+
+    mRampCount++;
+
+    // One native step per tick, unless that would be faster than kMinRampInterval
+    std::chrono::nanoseconds interval = std::chrono::nanoseconds(mRampDuration) / steps;
+    setTimer(std::max<std::chrono::nanoseconds>(interval, kMinRampInterval));
+}
+
+void BacklightWriter::stepRamp() {
+    const auto elapsed = Clock::now() - mRampStartTime;
+    const double progress =
+            std::min(1.0, std::chrono::duration<double>(elapsed) /
+                                  std::chrono::duration<double>(mRampDuration));
+
+    const double delta = static_cast<double>(mRampTarget) - static_cast<double>(mRampStart);
+    const uint32_t value = std::lround(mRampStart + delta * applyRampCurve(mRampCurve, progress));
+
+    if (value != mCurrentBrightness) {
+        write(value);
+    }
+
+    if (progress >= 1.0) {
+        setTimer(std::chrono::nanoseconds::zero());
+    }
+}
+
+void BacklightWriter::setTimer(std::chrono::nanoseconds interval) {
+    if (mTimerFd < 0) {
+        return;
+    }
+
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(interval);
+    const struct timespec ts = {
+            .tv_sec = static_cast<time_t>(seconds.count()),
+            .tv_nsec = static_cast<long>((interval - seconds).count()),
+    };
+
+    // A zero interval disarms the timer
+    const struct itimerspec spec = {.it_interval = ts, .it_value = ts};
+    if (timerfd_settime(mTimerFd, 0, &spec, nullptr) < 0) {
+        PLOG(ERROR) << "Failed to set ramp timer";
+    }
+}
+
+void BacklightWriter::write(uint32_t value) {
+    mDevices.setBacklightRawBrightness(value);
+    mWriteCount++;
+    mCurrentBrightness = value;
+}
+
+void BacklightWriter::dump(int fd) const {
+    dprintf(fd, "Requests: %" PRIu64, mRequestCount.load());
+    dprintf(fd, ", writes: %" PRIu64, mWriteCount.load());
+    dprintf(fd, ", coalesced: %" PRIu64, mCoalescedCount.load());
+    dprintf(fd, ", ramps: %" PRIu64, mRampCount.load());
+    dprintf(fd, ", ramp duration: %" PRId64 "ms", static_cast<int64_t>(mRampDuration.count()));
+    dprintf(fd, ", ramp curve: %s", toString(mRampCurve));
+}
+
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
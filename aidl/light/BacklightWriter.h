@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include "Devices.h"
+#include "IDumpable.h"
+#include "Utils.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+
+/**
+ * Writes backlight colors from a dedicated thread.
+ * Colors posted while a write is in progress are coalesced, only the latest one gets written.
+ *
+ * When a ramp duration is configured, brightness changes are interpolated over that duration at
+ * the native resolution of the backlight, driven by a timerfd, instead of being applied at once.
+ * Turning the backlight on or off is never ramped.
+ */
+class BacklightWriter : public IDumpable {
+  public:
+    enum class RampCurve {
+        LINEAR,
+        EASE_OUT,
+        EASE_IN_OUT,
+    };
+
+    BacklightWriter() = delete;
+
+    /**
+     * Constructor.
+     * The ramp is configured from the vendor.light.backlight.ramp_duration_ms and
+     * vendor.light.backlight.ramp_curve properties.
+     *
+     * @param devices The devices to write the backlight colors to, only used from the writer
+     *                thread
+     */
+    BacklightWriter(Devices& devices);
+
+    /**
+     * Constructor.
+     *
+     * @param devices The devices to write the backlight colors to, only used from the writer
+     *                thread
+     * @param rampDuration The duration of brightness ramps, zero to apply changes at once
+     * @param rampCurve The interpolation used for brightness ramps
+     */
+    BacklightWriter(Devices& devices, std::chrono::milliseconds rampDuration,
+                    RampCurve rampCurve);
+    ~BacklightWriter();
+
+    /**
+     * Queue a color to be written, replacing any color not written yet.
+     * This never blocks on the backlight devices.
+     *
+     * @param color The color to write
+     */
+    void post(rgb color);
+
+    uint64_t getRequestCount() const { return mRequestCount; }
+    uint64_t getWriteCount() const { return mWriteCount; }
+    // Requests replaced by a later one before being written
+    uint64_t getCoalescedCount() const { return mCoalescedCount; }
+
+    void dump(int fd) const override;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    void threadLoop();
+    void apply(rgb color);
+    void startRamp(uint32_t target);
+    void stepRamp();
+    void setTimer(std::chrono::nanoseconds interval);
+    void write(uint32_t value);
+
+    Devices& mDevices;
+    const uint32_t mMaxBrightness;
+    const std::chrono::milliseconds mRampDuration;
+    const RampCurve mRampCurve;
+
+    ::android::base::unique_fd mEventFd;
+    ::android::base::unique_fd mTimerFd;
+    // Set when the fds couldn't be created, colors are then written from post()
+    const bool mSynchronous;
+
+    // Also held while writing in synchronous mode
+    std::mutex mMutex;
+    std::optional<rgb> mPendingColor;
+    bool mExiting;
+
+    // Only used from the writer thread
+    std::optional<uint32_t> mCurrentBrightness;
+    uint32_t mRampStart;
+    uint32_t mRampTarget;
+    Clock::time_point mRampStartTime;
+
+    std::atomic<uint64_t> mRequestCount;
+    std::atomic<uint64_t> mWriteCount;
+    std::atomic<uint64_t> mCoalescedCount;
+    std::atomic<uint64_t> mRampCount;
+
+    std::thread mThread;
+};
+
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -9,6 +9,7 @@
 #define LOG_TAG "Devices"
 
 #include <android-base/logging.h>
+#include <algorithm>
 
 namespace aidl {
 namespace android {
@@ -20,11 +21,11 @@ static const std::string kBacklightDevices[] = {
         "panel0-backlight",
 };
 
-static std::vector<BacklightDevice> getBacklightDevices() {
+static std::vector<BacklightDevice> getBacklightDevices(const std::string& classPath) {
     std::vector<BacklightDevice> devices;
 
     for (const auto& device : kBacklightDevices) {
-        BacklightDevice backlight(device);
+        BacklightDevice backlight(device, classPath);
         if (backlight.exists()) {
             LOG(INFO) << "Found backlight device: " << backlight.getName();
             devices.push_back(backlight);
@@ -95,6 +96,8 @@ static std::vector<RgbLedDevice> getNotificationRgbLedDevices() {
     return devices;
 }
 
+static constexpr int kNotificationBlinkId = 0;
+
 static const std::string kNotificationLedDevices[] = {
         "left",
         "white",
@@ -114,8 +117,8 @@ static std::vector<LedDevice> getNotificationLedDevices() {
     return devices;
 }
 
-Devices::Devices()
-    : mBacklightDevices(getBacklightDevices()),
+Devices::Devices(const std::string& backlightClassPath)
+    : mBacklightDevices(getBacklightDevices(backlightClassPath)),
       mBacklightLedDevices(getBacklightLedDevices()),
       mButtonLedDevices(getButtonLedDevices()),
       mNotificationRgbLedDevices(getNotificationRgbLedDevices()),
@@ -154,21 +157,101 @@ void Devices::setBacklightColor(rgb color) {
     }
 }
 
+uint32_t Devices::getBacklightMaxBrightness() const {
+    uint32_t maxBrightness = 0;
+
+    for (const auto& device : mBacklightDevices) {
+        maxBrightness = std::max(maxBrightness, device.getMaxBrightness());
+    }
+    for (const auto& device : mBacklightLedDevices) {
+        maxBrightness = std::max(maxBrightness, device.getMaxBrightness());
+    }
+
+    return maxBrightness;
+}
+
+void Devices::setBacklightRawBrightness(uint32_t value) {
+    // value is relative to the finest backlight device, scale it for the others
+    const uint64_t maxBrightness = getBacklightMaxBrightness();
+    if (maxBrightness == 0) {
+        return;
+    }
+
+    for (auto& device : mBacklightDevices) {
+        device.setRawBrightness(value * device.getMaxBrightness() / maxBrightness);
+    }
+    for (auto& device : mBacklightLedDevices) {
+        device.setRawBrightness(value * device.getMaxBrightness() / maxBrightness);
+    }
+}
+
 void Devices::setButtonsColor(rgb color) {
     for (auto& device : mButtonLedDevices) {
         device.setBrightness(color.toBrightness());
     }
 }
 
+template <typename T>
+static bool needsSoftwareBlink(const T& device) {
+    return !device.supportsTimed() && !device.supportsBreath();
+}
+
 void Devices::setNotificationColor(rgb color, LightMode mode, uint32_t flashOnMs,
                                    uint32_t flashOffMs) {
+    const bool softwareBlink = mode == LightMode::TIMED && color.isLit();
+
+    // Keep the phase of a software blink that didn't change
+    const bool softwareBlinkChanged =
+            !softwareBlink || !mNotificationSoftwareBlink ||
+            mNotificationSoftwareBlink->color.red != color.red ||
+            mNotificationSoftwareBlink->color.green != color.green ||
+            mNotificationSoftwareBlink->color.blue != color.blue ||
+            mNotificationSoftwareBlink->flashOnMs != flashOnMs ||
+            mNotificationSoftwareBlink->flashOffMs != flashOffMs;
+    if (softwareBlinkChanged && mNotificationSoftwareBlink) {
+        mBlinker.stop(kNotificationBlinkId);
+        mNotificationSoftwareBlink.reset();
+    }
+
+    bool hasSoftwareBlinkDevices = false;
+
     for (auto& device : mNotificationRgbLedDevices) {
+        if (softwareBlink && needsSoftwareBlink(device)) {
+            hasSoftwareBlinkDevices = true;
+            continue;
+        }
         device.setBrightness(color, mode, flashOnMs, flashOffMs);
     }
 
     for (auto& device : mNotificationLedDevices) {
+        if (softwareBlink && needsSoftwareBlink(device)) {
+            hasSoftwareBlinkDevices = true;
+            continue;
+        }
         device.setBrightness(color.toBrightness(), mode, flashOnMs, flashOffMs);
     }
+
+    if (hasSoftwareBlinkDevices && softwareBlinkChanged) {
+        mNotificationSoftwareBlink = {color, flashOnMs, flashOffMs};
+        mBlinker.start(kNotificationBlinkId, flashOnMs, flashOffMs, [this, color](bool on) {
+            setNotificationSoftwareBlinkColor(on ? color : rgb());
+        });
+    }
+}
+
+void Devices::setNotificationSoftwareBlinkColor(rgb color) {
+    // All the channels and devices are switched together, keeping them in phase
+    for (auto& device : mNotificationRgbLedDevices) {
+        if (needsSoftwareBlink(device)) {
+            device.setBrightness(color);
+        }
+    }
+
+    for (auto& device : mNotificationLedDevices) {
+        if (needsSoftwareBlink(device)) {
+            device.setBrightness(color.toBrightness());
+        }
+    }
 }
 
 void Devices::dump(int fd) const {
@@ -210,6 +293,11 @@ void Devices::dump(int fd) const {
         device.dump(fd);
         dprintf(fd, "\n");
     }
+    dprintf(fd, "\n");
+
+    dprintf(fd, "Software blinker: ");
+    mBlinker.dump(fd);
+    dprintf(fd, "\n");
 
     return;
 }
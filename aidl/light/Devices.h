@@ -6,11 +6,13 @@
 
 #pragma once
 
+#include <optional>
 #include <vector>
 #include "BacklightDevice.h"
 #include "IDumpable.h"
 #include "LedDevice.h"
 #include "RgbLedDevice.h"
+#include "SoftwareBlinker.h"
 #include "Utils.h"
 
 namespace aidl {
@@ -20,13 +22,20 @@ namespace light {
 
 class Devices : public IDumpable {
   public:
-    Devices();
+    /**
+     * Constructor.
+     *
+     * @param backlightClassPath The directory holding the backlight devices
+     */
+    explicit Devices(const std::string& backlightClassPath = "/sys/class/backlight/");
 
     bool hasBacklightDevices() const;
     bool hasButtonDevices() const;
     bool hasNotificationDevices() const;
 
     void setBacklightColor(rgb color);
+    uint32_t getBacklightMaxBrightness() const;
+    void setBacklightRawBrightness(uint32_t value);
     void setButtonsColor(rgb color);
     void setNotificationColor(rgb color, LightMode mode = LightMode::STATIC, uint32_t flashOnMs = 0,
                               uint32_t flashOffMs = 0);
@@ -44,6 +53,18 @@ class Devices : public IDumpable {
     // Notifications
     std::vector<RgbLedDevice> mNotificationRgbLedDevices;
     std::vector<LedDevice> mNotificationLedDevices;
+
+    // Timed mode for notification devices supporting neither timed mode nor breathing
+    struct SoftwareBlink {
+        rgb color;
+        uint32_t flashOnMs;
+        uint32_t flashOffMs;
+    };
+    std::optional<SoftwareBlink> mNotificationSoftwareBlink;
+    void setNotificationSoftwareBlinkColor(rgb color);
+
+    // Declared last, so that it stops before the devices it drives are destroyed
+    SoftwareBlinker mBlinker;
 };
 
 }  // namespace light
@@ -9,7 +9,9 @@
 #define LOG_TAG "LedDevice"
 
 #include <android-base/logging.h>
-#include <fstream>
+#include <inttypes.h>
+#include <algorithm>
+#include <set>
 #include "Utils.h"
 
 namespace aidl {
@@ -36,28 +38,59 @@ static const std::string kPauseLoNode = "pause_lo";
 static const std::string kPauseHiNode = "pause_hi";
 static const std::string kRampStepMsNode = "ramp_step_ms";
 
+static const std::string kTimedNodes[] = {
+        kBlinkNode, kStartIdxNode, kDutyPctsNode, kPauseLoNode, kPauseHiNode, kRampStepMsNode,
+};
+
+static const std::string kWritableNodes[] = {
+        kBrightnessNode, kBlinkNode,   kStartIdxNode,   kDutyPctsNode,
+        kPauseLoNode,    kPauseHiNode, kRampStepMsNode,
+};
+
 static constexpr int kRampSteps = 8;
 static constexpr int kRampMaxStepDurationMs = 50;
 
-LedDevice::LedDevice(std::string name)
-    : mName(name), mIdx(0), mBasePath(kBaseLedsPath + name + "/") {
-    if (!readFromFile(mBasePath + kMaxBrightnessNode, mMaxBrightness)) {
-        mMaxBrightness = kDefaultMaxBrightness;
+LedDevice::Capabilities LedDevice::probeCapabilities(const std::string& basePath) {
+    const std::set<std::string> nodes = listFiles(basePath);
+    Capabilities caps = {
+            .exists = nodes.count(kBrightnessNode) > 0,
+            .maxBrightness = kDefaultMaxBrightness,
+            .breathNode = "",
+            .supportsTimed = true,
+    };
+
+    if (nodes.count(kMaxBrightnessNode) > 0 &&
+        !readFromFile(basePath + kMaxBrightnessNode, caps.maxBrightness)) {
+        caps.maxBrightness = kDefaultMaxBrightness;
     }
 
     for (const auto& node : kBreathNodes) {
-        if (std::ifstream(mBasePath + node).good()) {
-            mBreathNode = node;
+        if (nodes.count(node) > 0) {
+            caps.breathNode = node;
             break;
         }
     }
 
-    mSupportsTimed = std::ifstream(mBasePath + kBlinkNode).good() &&
-                     std::ifstream(mBasePath + kStartIdxNode).good() &&
-                     std::ifstream(mBasePath + kDutyPctsNode).good() &&
-                     std::ifstream(mBasePath + kPauseLoNode).good() &&
-                     std::ifstream(mBasePath + kPauseHiNode).good() &&
-                     std::ifstream(mBasePath + kRampStepMsNode).good();
+    for (const auto& node : kTimedNodes) {
+        caps.supportsTimed &= nodes.count(node) > 0;
+    }
+
+    return caps;
+}
+
+LedDevice::LedDevice(std::string name)
+    : mName(name),
+      mIdx(0),
+      mBasePath(kBaseLedsPath + name + "/"),
+      mCaps(probeCapabilities(mBasePath)) {
+    // Only the HAL drives LEDs, values written again can be skipped
+    for (const auto& node : kWritableNodes) {
+        mNodes.emplace(node, SysfsNode(mBasePath + node, true));
+    }
+    if (supportsBreath()) {
+        // Shares the shadow state of the blink node when both are the same
+        mNodes.emplace(mCaps.breathNode, SysfsNode(mBasePath + mCaps.breathNode, true));
+    }
 }
 
 std::string LedDevice::getName() const {
@@ -65,15 +98,15 @@ std::string LedDevice::getName() const {
 }
 
 bool LedDevice::supportsBreath() const {
-    return !mBreathNode.empty();
+    return !mCaps.breathNode.empty();
 }
 
 bool LedDevice::supportsTimed() const {
-    return mSupportsTimed;
+    return mCaps.supportsTimed;
 }
 
 bool LedDevice::exists() const {
-    return std::ifstream(mBasePath + kBrightnessNode).good();
+    return mCaps.exists;
 }
 
 static std::string getScaledDutyPercent(uint8_t brightness) {
@@ -89,17 +122,40 @@ static std::string getScaledDutyPercent(uint8_t brightness) {
 
 bool LedDevice::setBrightness(uint8_t value, LightMode mode, uint32_t flashOnMs,
                               uint32_t flashOffMs) {
+    const Request request = {value, mode, flashOnMs, flashOffMs};
+    if (mLastRequest == request) {
+        mSkippedRequestCount++;
+        return true;
+    }
+
+    bool rc = applyBrightness(value, mode, flashOnMs, flashOffMs);
+    if (rc) {
+        mLastRequest = request;
+    } else {
+        mLastRequest.reset();
+    }
+
+    return rc;
+}
+
+bool LedDevice::applyBrightness(uint8_t value, LightMode mode, uint32_t flashOnMs,
+                                uint32_t flashOffMs) {
+    if (!mLastRequest || mLastRequest->mode != mode) {
+        // Changing the blink or breath state may change the brightness behind our back
+        mNodes.at(kBrightnessNode).invalidate();
+    }
+
     // Disable current blinking
-    if (mSupportsTimed) {
-        writeToFile(mBasePath + kBlinkNode, 0);
+    if (mCaps.supportsTimed) {
+        writeNode(kBlinkNode, 0);
     }
     if (supportsBreath()) {
-        writeToFile(mBasePath + mBreathNode, 0);
+        writeNode(mCaps.breathNode, 0);
     }
 
     switch (mode) {
         case LightMode::TIMED:
-            if (mSupportsTimed) {
+            if (mCaps.supportsTimed) {
                 int32_t stepDuration = kRampMaxStepDurationMs;
                 int32_t pauseLo = flashOffMs;
                 int32_t pauseHi = flashOnMs - (stepDuration * kRampSteps * 2);
@@ -109,26 +165,24 @@ bool LedDevice::setBrightness(uint8_t value, LightMode mode, uint32_t flashOnMs,
                     pauseHi = 0;
                 }
 
-                return writeToFile(mBasePath + kStartIdxNode, mIdx * kRampSteps) &&
-                       writeToFile(mBasePath + kDutyPctsNode, getScaledDutyPercent(value)) &&
-                       writeToFile(mBasePath + kPauseLoNode, pauseLo) &&
-                       writeToFile(mBasePath + kPauseHiNode, pauseHi) &&
-                       writeToFile(mBasePath + kRampStepMsNode, stepDuration) &&
-                       writeToFile(mBasePath + kBlinkNode, 1);
+                return writeNode(kStartIdxNode, mIdx * kRampSteps) &&
+                       writeNode(kDutyPctsNode, getScaledDutyPercent(value)) &&
+                       writeNode(kPauseLoNode, pauseLo) && writeNode(kPauseHiNode, pauseHi) &&
+                       writeNode(kRampStepMsNode, stepDuration) && writeNode(kBlinkNode, 1);
             }
 
             // Fallthrough to breath mode if timed is not supported
             FALLTHROUGH_INTENDED;
         case LightMode::BREATH:
             if (supportsBreath()) {
-                return writeToFile(mBasePath + mBreathNode, value > 0 ? 1 : 0);
+                return writeNode(mCaps.breathNode, value > 0 ? 1 : 0);
                 break;
             }
 
             // Fallthrough to static mode if breath is not supported
             FALLTHROUGH_INTENDED;
         case LightMode::STATIC:
-            return writeToFile(mBasePath + kBrightnessNode, scaleBrightness(value, mMaxBrightness));
+            return writeNode(kBrightnessNode, scaleBrightness(value, mCaps.maxBrightness));
             break;
         default:
             LOG(ERROR) << "Unknown mode: " << mode;
@@ -137,6 +191,15 @@ bool LedDevice::setBrightness(uint8_t value, LightMode mode, uint32_t flashOnMs,
     }
 }
 
+uint32_t LedDevice::getMaxBrightness() const {
+    return mCaps.maxBrightness;
+}
+
+bool LedDevice::setRawBrightness(uint32_t value) {
+    mLastRequest.reset();
+    return writeNode(kBrightnessNode, std::min(value, mCaps.maxBrightness));
+}
+
 void LedDevice::setIdx(int idx) {
     mIdx = idx;
 }
@@ -146,10 +209,34 @@ void LedDevice::dump(int fd) const {
     dprintf(fd, ", index: %d", mIdx);
     dprintf(fd, ", exists: %d", exists());
     dprintf(fd, ", base path: %s", mBasePath.c_str());
-    dprintf(fd, ", max brightness: %u", mMaxBrightness);
+    dprintf(fd, ", max brightness: %u", mCaps.maxBrightness);
     dprintf(fd, ", supports breath: %d", supportsBreath());
     dprintf(fd, ", supports timed: %d", supportsTimed());
-    dprintf(fd, ", breath node: %s", mBreathNode.c_str());
+    dprintf(fd, ", breath node: %s", mCaps.breathNode.c_str());
+
+    uint64_t writes = 0;
+    uint64_t skippedWrites = 0;
+    uint64_t errors = 0;
+    for (const auto& [name, node] : mNodes) {
+        writes += node.getWriteCount();
+        skippedWrites += node.getSkippedWriteCount();
+        errors += node.getErrorCount();
+    }
+    dprintf(fd, ", writes: %" PRIu64, writes);
+    dprintf(fd, ", skipped writes: %" PRIu64, skippedWrites);
+    dprintf(fd, ", errors: %" PRIu64, errors);
+    dprintf(fd, ", skipped requests: %" PRIu64, mSkippedRequestCount.load());
+
+    // Only list the nodes that have been used
+    for (const auto& [name, node] : mNodes) {
+        if (node.getWriteCount() == 0 && node.getSkippedWriteCount() == 0 &&
+            node.getErrorCount() == 0) {
+            continue;
+        }
+
+        dprintf(fd, "\n  - %s: ", name.c_str());
+        node.dump(fd);
+    }
 }
 
 }  // namespace light
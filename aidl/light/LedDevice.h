@@ -7,8 +7,12 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
+#include <optional>
 #include <string>
 #include "IDumpable.h"
+#include "SysfsNode.h"
+#include "Utils.h"
 
 namespace aidl {
 namespace android {
@@ -45,6 +49,7 @@ class LedDevice : public IDumpable {
 
     /**
      * Return whether this LED device exists.
+     * This and the other capabilities are probed once, when the LED device is created.
      *
      * @return bool true if the LED device exists, false otherwise
      */
@@ -78,6 +83,22 @@ class LedDevice : public IDumpable {
     bool setBrightness(uint8_t value, LightMode mode = LightMode::STATIC, uint32_t flashOnMs = 0,
                        uint32_t flashOffMs = 0);
 
+    /**
+     * Get the maximum brightness of this LED device, in its native units.
+     *
+     * @return uint32_t The maximum brightness
+     */
+    uint32_t getMaxBrightness() const;
+
+    /**
+     * Set the brightness of this LED device in its native units, bypassing the 8-bit
+     * scaling. Used to ramp the backlight at the full resolution of the panel.
+     *
+     * @param value The brightness value to set, clamped to getMaxBrightness()
+     * @return bool true if the brightness was set successfully, false otherwise
+     */
+    bool setRawBrightness(uint32_t value);
+
     /**
      * Set the index of the LED device.
      *
@@ -88,12 +109,44 @@ class LedDevice : public IDumpable {
     void dump(int fd) const override;
 
   private:
+    bool applyBrightness(uint8_t value, LightMode mode, uint32_t flashOnMs, uint32_t flashOffMs);
+
+    struct Capabilities {
+        bool exists;
+        uint32_t maxBrightness;
+        // Empty when breathing isn't supported
+        std::string breathNode;
+        bool supportsTimed;
+    };
+
+    static Capabilities probeCapabilities(const std::string& basePath);
+
     std::string mName;
     int mIdx;
     std::string mBasePath;
-    uint32_t mMaxBrightness;
-    std::string mBreathNode;
-    bool mSupportsTimed;
+    const Capabilities mCaps;
+
+    std::map<std::string, SysfsNode> mNodes;
+
+    struct Request {
+        uint8_t value;
+        LightMode mode;
+        uint32_t flashOnMs;
+        uint32_t flashOffMs;
+
+        bool operator==(const Request& other) const {
+            return value == other.value && mode == other.mode && flashOnMs == other.flashOnMs &&
+                   flashOffMs == other.flashOffMs;
+        }
+    };
+    // Last request successfully applied, identical requests are skipped
+    std::optional<Request> mLastRequest;
+    AtomicCounter mSkippedRequestCount;
+
+    template <typename T>
+    bool writeNode(const std::string& node, T value) {
+        return mNodes.at(node).write(value);
+    }
 };
 
 }  // namespace light
@@ -9,6 +9,8 @@
 #define LOG_TAG "Lights"
 
 #include <android-base/logging.h>
+#include <inttypes.h>
+#include <chrono>
 #include "Utils.h"
 
 namespace aidl {
@@ -19,7 +21,9 @@ namespace light {
 #define AutoHwLight(light) \
     { .id = static_cast<int32_t>(light), .ordinal = 0, .type = light }
 
-Lights::Lights() {
+Lights::Lights()
+    : mUnsupportedCallCount(0),
+      mBacklightWriter(mDevices) {
     if (mDevices.hasBacklightDevices()) {
         mLights.push_back(AutoHwLight(LightType::BACKLIGHT));
     }
@@ -33,15 +37,26 @@ Lights::Lights() {
         mLights.push_back(AutoHwLight(LightType::NOTIFICATIONS));
         mLights.push_back(AutoHwLight(LightType::ATTENTION));
     }
+
+    for (const auto& light : mLights) {
+        mCallCounts[light.id] = 0;
+    }
 }
 
 ndk::ScopedAStatus Lights::setLightState(int32_t id, const HwLightState& state) {
     rgb color(state.color);
 
+    auto callCount = mCallCounts.find(id);
+    if (callCount != mCallCounts.end()) {
+        callCount->second++;
+    } else {
+        mUnsupportedCallCount++;
+    }
+
     LightType type = static_cast<LightType>(id);
     switch (type) {
         case LightType::BACKLIGHT:
-            mDevices.setBacklightColor(color);
+            mBacklightWriter.post(color);
             break;
         case LightType::BUTTONS:
             mDevices.setButtonsColor(color);
@@ -80,19 +95,30 @@ binder_status_t Lights::dump(int fd, const char** /*args*/, uint32_t /*numArgs*/
 
     dprintf(fd, "Lights:\n");
     for (const auto& light : mLights) {
-        dprintf(fd, "- %d: LightType::%s\n", light.id, toString(light.type).c_str());
+        dprintf(fd, "- %d: LightType::%s, calls: %" PRIu64 "\n", light.id,
+                toString(light.type).c_str(), mCallCounts.at(light.id).load());
     }
+    dprintf(fd, "Calls for unsupported lights: %" PRIu64 "\n", mUnsupportedCallCount.load());
     dprintf(fd, "\n");
 
+    dprintf(fd, "Notification lock hold time: ");
+    mLedMutexHoldTime.dump(fd);
+    dprintf(fd, "\n\n");
+
     dprintf(fd, "Devices:\n");
     mDevices.dump(fd);
     dprintf(fd, "\n");
 
+    dprintf(fd, "Backlight writer:\n");
+    mBacklightWriter.dump(fd);
+    dprintf(fd, "\n");
+
     return STATUS_OK;
 }
 
 void Lights::updateNotificationColor() {
     std::lock_guard<std::mutex> lock(mLedMutex);
+    const auto lockTime = std::chrono::steady_clock::now();
 
     bool isBatteryLit = rgb(mLastBatteryState.color).isLit();
     bool isAttentionLit = rgb(mLastAttentionState.color).isLit();
@@ -124,6 +150,7 @@ void Lights::updateNotificationColor() {
 
     mDevices.setNotificationColor(color, lightMode, state.flashOnMs, state.flashOffMs);
 
+    mLedMutexHoldTime.record(std::chrono::steady_clock::now() - lockTime);
     return;
 }
 
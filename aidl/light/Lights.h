@@ -7,14 +7,20 @@
 #pragma once
 
 #include <aidl/android/hardware/light/BnLights.h>
+#include <atomic>
+#include <map>
 #include <mutex>
+#include "BacklightWriter.h"
 #include "Devices.h"
+#include "LatencyHistogram.h"
 
 namespace aidl {
 namespace android {
 namespace hardware {
 namespace light {
 
+using ::android::hardware::stats::LatencyHistogram;
+
 class Lights : public BnLights {
   public:
     Lights();
@@ -27,12 +33,18 @@ class Lights : public BnLights {
   private:
     std::vector<HwLight> mLights;
 
+    // setLightState calls per light id, only filled in the constructor
+    std::map<int32_t, std::atomic<uint64_t>> mCallCounts;
+    std::atomic<uint64_t> mUnsupportedCallCount;
+
     Devices mDevices;
+    BacklightWriter mBacklightWriter;
 
     HwLightState mLastBatteryState;
     HwLightState mLastNotificationsState;
     HwLightState mLastAttentionState;
     std::mutex mLedMutex;
+    LatencyHistogram mLedMutexHoldTime;
 
     void updateNotificationColor();
 };
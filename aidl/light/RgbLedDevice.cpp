@@ -9,6 +9,7 @@
 #define LOG_TAG "RgbLedDevice"
 
 #include <android-base/logging.h>
+#include <inttypes.h>
 #include "Utils.h"
 
 namespace aidl {
@@ -17,7 +18,18 @@ namespace hardware {
 namespace light {
 
 RgbLedDevice::RgbLedDevice(LedDevice red, LedDevice green, LedDevice blue, std::string rgbSyncNode)
-    : mRed(red), mGreen(green), mBlue(blue), mRgbSyncNode(rgbSyncNode), mColors(Color::NONE) {
+    : mRed(red),
+      mGreen(green),
+      mBlue(blue),
+      mRgbSyncNode(rgbSyncNode),
+      mColors(Color::NONE),
+      mSupportsBreath((!mRed.exists() || mRed.supportsBreath()) &&
+                      (!mGreen.exists() || mGreen.supportsBreath()) &&
+                      (!mBlue.exists() || mBlue.supportsBreath())),
+      mSupportsTimed((!mRed.exists() || mRed.supportsTimed()) &&
+                     (!mGreen.exists() || mGreen.supportsTimed()) &&
+                     (!mBlue.exists() || mBlue.supportsTimed())),
+      mSupportsRgbSync(isFile(rgbSyncNode)) {
     if (mRed.exists()) {
         mColors |= Color::RED;
     }
@@ -39,30 +51,44 @@ bool RgbLedDevice::exists() const {
 }
 
 bool RgbLedDevice::supportsBreath() const {
-    return (!mRed.exists() || mRed.supportsBreath()) &&
-           (!mGreen.exists() || mGreen.supportsBreath()) &&
-           (!mBlue.exists() || mBlue.supportsBreath());
+    return mSupportsBreath;
 }
 
 bool RgbLedDevice::supportsTimed() const {
-    return (!mRed.exists() || mRed.supportsTimed()) &&
-           (!mGreen.exists() || mGreen.supportsTimed()) &&
-           (!mBlue.exists() || mBlue.supportsTimed());
+    return mSupportsTimed;
 }
 
 bool RgbLedDevice::supportsRgbSync() const {
-    return std::ifstream(mRgbSyncNode).good();
+    return mSupportsRgbSync;
 }
 
 bool RgbLedDevice::setBrightness(rgb color, LightMode mode, uint32_t flashOnMs,
                                  uint32_t flashOffMs) {
-    bool rc = true;
-
     if (mColors == Color::NONE) {
         LOG(ERROR) << "No LEDs found";
         return false;
     }
 
+    const Request request = {color, mode, flashOnMs, flashOffMs};
+    if (mLastRequest == request) {
+        mSkippedRequestCount++;
+        return true;
+    }
+
+    bool rc = applyBrightness(color, mode, flashOnMs, flashOffMs);
+    if (rc) {
+        mLastRequest = request;
+    } else {
+        mLastRequest.reset();
+    }
+
+    return rc;
+}
+
+bool RgbLedDevice::applyBrightness(rgb color, LightMode mode, uint32_t flashOnMs,
+                                   uint32_t flashOffMs) {
+    bool rc = true;
+
     if (mode == LightMode::TIMED && !supportsTimed()) {
         // Not all LEDs support timed mode, force breathing mode
         mode = LightMode::BREATH;
@@ -74,7 +100,7 @@ bool RgbLedDevice::setBrightness(rgb color, LightMode mode, uint32_t flashOnMs,
     }
 
     if (mode == LightMode::TIMED && supportsRgbSync()) {
-        rc &= writeToFile(mRgbSyncNode, 0);
+        rc &= mRgbSyncNode.write(0);
     }
 
     if (mColors == Color::ALL) {
@@ -110,7 +136,7 @@ bool RgbLedDevice::setBrightness(rgb color, LightMode mode, uint32_t flashOnMs,
     }
 
     if (mode == LightMode::TIMED && supportsRgbSync()) {
-        rc &= writeToFile(mRgbSyncNode, 1);
+        rc &= mRgbSyncNode.write(1);
     }
 
     return rc;
@@ -121,6 +147,7 @@ void RgbLedDevice::dump(int fd) const {
     dprintf(fd, ", supports breath: %d", supportsBreath());
     dprintf(fd, ", supports timed: %d", supportsTimed());
     dprintf(fd, ", supports RGB sync: %d", supportsRgbSync());
+    dprintf(fd, ", skipped requests: %" PRIu64, mSkippedRequestCount.load());
     dprintf(fd, ", colors:");
     if (mColors != Color::NONE) {
         if (mColors & Color::RED) {
@@ -138,6 +165,10 @@ void RgbLedDevice::dump(int fd) const {
     } else {
         dprintf(fd, " None");
     }
+    if (supportsRgbSync()) {
+        dprintf(fd, "\nRGB sync: ");
+        mRgbSyncNode.dump(fd);
+    }
 }
 
 }  // namespace light
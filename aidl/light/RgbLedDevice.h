@@ -6,8 +6,10 @@
 
 #pragma once
 
+#include <optional>
 #include "IDumpable.h"
 #include "LedDevice.h"
+#include "SysfsNode.h"
 #include "Utils.h"
 
 namespace aidl {
@@ -37,6 +39,7 @@ class RgbLedDevice : public IDumpable {
     /**
      * Return whether this RGB LED device exists.
      * This is true when at least one of the LEDs exists.
+     * This and the other capabilities are probed once, when the RGB LED device is created.
      *
      * @return bool true if the RGB LED device exists, false otherwise
      */
@@ -71,6 +74,7 @@ class RgbLedDevice : public IDumpable {
 
     /**
      * Set the brightness of this RGB LED device.
+     * Setting the same state again is skipped.
      *
      * @param color The color to set
      * @param mode The mode to set
@@ -93,9 +97,30 @@ class RgbLedDevice : public IDumpable {
     LedDevice mRed;
     LedDevice mGreen;
     LedDevice mBlue;
-    std::string mRgbSyncNode;
+    SysfsNode mRgbSyncNode;
 
     int mColors;
+    bool mSupportsBreath;
+    bool mSupportsTimed;
+    bool mSupportsRgbSync;
+
+    struct Request {
+        rgb color;
+        LightMode mode;
+        uint32_t flashOnMs;
+        uint32_t flashOffMs;
+
+        bool operator==(const Request& other) const {
+            return color.red == other.color.red && color.green == other.color.green &&
+                   color.blue == other.color.blue && mode == other.mode &&
+                   flashOnMs == other.flashOnMs && flashOffMs == other.flashOffMs;
+        }
+    };
+    // Last request successfully applied, identical requests are skipped
+    std::optional<Request> mLastRequest;
+    AtomicCounter mSkippedRequestCount;
+
+    bool applyBrightness(rgb color, LightMode mode, uint32_t flashOnMs, uint32_t flashOffMs);
 };
 
 }  // namespace light
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "SoftwareBlinker.h"
+
+#define LOG_TAG "SoftwareBlinker"
+
+#include <android-base/logging.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <algorithm>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+
+SoftwareBlinker::SoftwareBlinker()
+    : mEventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      mTimerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)),
+      mAvailable(mEventFd >= 0 && mTimerFd >= 0),
+      mExiting(false),
+      mToggleCount(0),
+      mWakeupCount(0) {
+    if (!mAvailable) {
+        // Without them the thread would never wake up, nor exit
+        PLOG(ERROR) << "Failed to create software blinker fds, software blink unavailable";
+        return;
+    }
+
+    mThread = std::thread(&SoftwareBlinker::threadLoop, this);
+}
+
+SoftwareBlinker::~SoftwareBlinker() {
+    if (!mAvailable) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExiting = true;
+    }
+    eventfd_write(mEventFd, 1);
+    mThread.join();
+}
+
+void SoftwareBlinker::start(int id, uint32_t onMs, uint32_t offMs, Callback callback) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mPatterns.erase(id);
+
+    if (!mAvailable) {
+        callback(onMs > 0);
+        return;
+    }
+
+    if (onMs == 0 || offMs == 0) {
+        callback(onMs > 0);
+        armTimer();
+        return;
+    }
+
+    callback(true);
+    mPatterns[id] = {
+            .onDuration = std::chrono::milliseconds(onMs),
+            .offDuration = std::chrono::milliseconds(offMs),
+            .callback = std::move(callback),
+            .on = true,
+            .nextToggle = Clock::now() + std::chrono::milliseconds(onMs),
+    };
+    armTimer();
+}
+
+void SoftwareBlinker::stop(int id) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mPatterns.erase(id) > 0) {
+        armTimer();
+    }
+}
+
+void SoftwareBlinker::threadLoop() {
+    struct pollfd fds[] = {
+            {.fd = mEventFd, .events = POLLIN},
+            {.fd = mTimerFd, .events = POLLIN},
+    };
+
+    while (true) {
+        if (TEMP_FAILURE_RETRY(poll(fds, std::size(fds), -1)) < 0) {
+            PLOG(ERROR) << "Failed to poll";
+            return;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            eventfd_t value;
+            eventfd_read(mEventFd, &value);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mExiting) {
+                return;
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            uint64_t expirations;
+            if (read(mTimerFd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                toggleExpired();
+            }
+        }
+    }
+}
+
+void SoftwareBlinker::toggleExpired() {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mWakeupCount++;
+
+    const auto now = Clock::now();
+    for (auto& [id, pattern] : mPatterns) {
+        if (pattern.nextToggle > now) {
+            continue;
+        }
+
+        pattern.on = !pattern.on;
+        pattern.callback(pattern.on);
+        mToggleCount++;
+
+        // Advance from the scheduled time rather than from now to avoid drifting, unless we
+        // fell more than a whole phase behind
+        pattern.nextToggle += pattern.on ? pattern.onDuration : pattern.offDuration;
+        if (pattern.nextToggle <= now) {
+            pattern.nextToggle = now + (pattern.on ? pattern.onDuration : pattern.offDuration);
+        }
+    }
+
+    armTimer();
+}
+
+void SoftwareBlinker::armTimer() {
+    struct itimerspec spec = {};
+
+    if (!mPatterns.empty()) {
+        Clock::time_point deadline = Clock::time_point::max();
+        for (const auto& [id, pattern] : mPatterns) {
+            deadline = std::min(deadline, pattern.nextToggle);
+        }
+
+        // steady_clock is CLOCK_MONOTONIC, a zero it_value would disarm the timer
+        const auto nanoseconds = std::max<std::chrono::nanoseconds>(
+                deadline.time_since_epoch(), std::chrono::nanoseconds(1));
+        const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(nanoseconds);
+        spec.it_value = {
+                .tv_sec = static_cast<time_t>(seconds.count()),
+                .tv_nsec = static_cast<long>((nanoseconds - seconds).count()),
+        };
+    }
+
+    // A zero it_value disarms the timer
+    if (timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+        PLOG(ERROR) << "Failed to set blink timer";
+    }
+}
+
+void SoftwareBlinker::dump(int fd) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (!mAvailable) {
+        dprintf(fd, "Unavailable");
+        return;
+    }
+
+    dprintf(fd, "Active patterns: %zu", mPatterns.size());
+    dprintf(fd, ", toggles: %" PRIu64, mToggleCount);
+    dprintf(fd, ", wakeups: %" PRIu64, mWakeupCount);
+    for (const auto& [id, pattern] : mPatterns) {
+        dprintf(fd, "\n- %d: on %" PRId64 "ms, off %" PRId64 "ms, currently %s", id,
+                static_cast<int64_t>(pattern.onDuration.count()),
+                static_cast<int64_t>(pattern.offDuration.count()), pattern.on ? "on" : "off");
+    }
+}
+
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
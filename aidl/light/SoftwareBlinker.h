@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "IDumpable.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+
+/**
+ * Blinks LEDs that have neither timed mode nor breathing support.
+ *
+ * All patterns are driven from a single thread, woken up by a single timerfd armed for the
+ * earliest pending toggle. The thread sleeps without any timer armed when no pattern is active.
+ * A pattern toggles everything it drives from one callback, so e.g. the channels of an RGB LED
+ * stay phase aligned.
+ */
+class SoftwareBlinker : public IDumpable {
+  public:
+    /**
+     * Called to switch the LEDs of a pattern on or off, with the blinker lock held.
+     * It must not call back into the blinker.
+     */
+    using Callback = std::function<void(bool on)>;
+
+    SoftwareBlinker();
+    ~SoftwareBlinker();
+
+    /**
+     * Start blinking.
+     * The LEDs are switched on right away from the calling thread, replacing any pattern
+     * already running with the same id. When one of the durations is 0 the LEDs are set once,
+     * steadily on or off, and no pattern is kept.
+     *
+     * @param id The id of the pattern
+     * @param onMs How long the LEDs stay on
+     * @param offMs How long the LEDs stay off
+     * @param callback The callback switching the LEDs on or off
+     */
+    void start(int id, uint32_t onMs, uint32_t offMs, Callback callback);
+
+    /**
+     * Stop blinking.
+     * Once this returns, the callback of the pattern isn't running and won't be called anymore.
+     * The LEDs are left in whatever state they were last set to.
+     *
+     * @param id The id of the pattern
+     */
+    void stop(int id);
+
+    /**
+     * Whether patterns actually blink. Without the thread, start() only sets the LEDs steadily.
+     */
+    bool isAvailable() const { return mAvailable; }
+
+    void dump(int fd) const override;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pattern {
+        std::chrono::milliseconds onDuration;
+        std::chrono::milliseconds offDuration;
+        Callback callback;
+        bool on;
+        Clock::time_point nextToggle;
+    };
+
+    void threadLoop();
+    void toggleExpired();
+    void armTimer();
+
+    ::android::base::unique_fd mEventFd;
+    ::android::base::unique_fd mTimerFd;
+    const bool mAvailable;
+
+    mutable std::mutex mMutex;
+    std::map<int, Pattern> mPatterns;
+    bool mExiting;
+    uint64_t mToggleCount;
+    uint64_t mWakeupCount;
+
+    std::thread mThread;
+};
+
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
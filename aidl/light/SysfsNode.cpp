@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "SysfsNode.h"
+
+#define LOG_TAG "SysfsNode"
+
+#include <android-base/logging.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <chrono>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+
+SysfsNode::SysfsNode(std::string path, bool skipUnchanged)
+    : mPath(path), mSkipUnchanged(skipUnchanged), mState(std::make_shared<State>()) {}
+
+std::string SysfsNode::getPath() const {
+    return mPath;
+}
+
+bool SysfsNode::write(const std::string& value) {
+    std::lock_guard<std::mutex> lock(mState->mutex);
+
+    if (mSkipUnchanged && mState->value == value) {
+        mState->skippedWriteCount++;
+        return true;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    if (mState->fd < 0) {
+        mState->fd.reset(TEMP_FAILURE_RETRY(open(mPath.c_str(), O_WRONLY | O_CLOEXEC)));
+        if (mState->fd < 0) {
+            PLOG(ERROR) << "Failed to open " << mPath;
+            mState->errorCount++;
+            return false;
+        }
+    }
+
+    // sysfs attributes are always written from the start
+    ssize_t ret = TEMP_FAILURE_RETRY(pwrite(mState->fd, value.c_str(), value.size(), 0));
+    mState->writeCount++;
+    mState->writeLatency.record(std::chrono::steady_clock::now() - start);
+    if (ret != static_cast<ssize_t>(value.size())) {
+        PLOG(ERROR) << "Failed to write " << value << " to " << mPath;
+        mState->errorCount++;
+        // Reopen the node and write the value again on the next write
+        mState->fd.reset();
+        mState->value.reset();
+        return false;
+    }
+
+    mState->value = value;
+    return true;
+}
+
+void SysfsNode::invalidate() {
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    mState->value.reset();
+}
+
+uint64_t SysfsNode::getWriteCount() const {
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->writeCount;
+}
+
+uint64_t SysfsNode::getSkippedWriteCount() const {
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->skippedWriteCount;
+}
+
+uint64_t SysfsNode::getErrorCount() const {
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->errorCount;
+}
+
+void SysfsNode::dump(int fd) const {
+    std::lock_guard<std::mutex> lock(mState->mutex);
+
+    dprintf(fd, "writes: %" PRIu64, mState->writeCount);
+    dprintf(fd, ", skipped writes: %" PRIu64, mState->skippedWriteCount);
+    dprintf(fd, ", errors: %" PRIu64, mState->errorCount);
+    dprintf(fd, ", write latency: ");
+    mState->writeLatency.dump(fd);
+}
+
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include "IDumpable.h"
+#include "LatencyHistogram.h"
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace light {
+
+using ::android::hardware::stats::LatencyHistogram;
+
+/**
+ * A sysfs node kept open for writing.
+ * The node is opened on the first write and stays open afterwards. Nodes only the HAL writes to can
+ * remember the last written value and skip writing the same value again. Copies share the same
+ * file descriptor and last written value, as well as the write statistics.
+ */
+class SysfsNode : public IDumpable {
+  public:
+    SysfsNode() = delete;
+
+    /**
+     * Constructor.
+     *
+     * @param path The path of the sysfs node
+     * @param skipUnchanged Whether to skip writing the last written value again. Not for nodes
+     *                      the kernel may change on its own.
+     */
+    SysfsNode(std::string path, bool skipUnchanged = false);
+
+    /**
+     * Get the path of the sysfs node.
+     *
+     * @return std::string The path of the sysfs node
+     */
+    std::string getPath() const;
+
+    /**
+     * Write a value to the sysfs node, unless skipping unchanged values and it is the last value
+     * written.
+     *
+     * @param value The value to write
+     * @return bool true if the value was written successfully or skipped, false otherwise
+     */
+    bool write(const std::string& value);
+
+    template <typename T>
+    bool write(T value) {
+        return write(std::to_string(value));
+    }
+
+    /**
+     * Forget the last written value, so that the next write is never skipped.
+     * Use this when the kernel may have changed the value behind our back.
+     */
+    void invalidate();
+
+    /**
+     * Get the number of writes issued to the sysfs node.
+     *
+     * @return uint64_t The number of writes issued
+     */
+    uint64_t getWriteCount() const;
+
+    /**
+     * Get the number of writes skipped because the value didn't change.
+     *
+     * @return uint64_t The number of writes skipped
+     */
+    uint64_t getSkippedWriteCount() const;
+
+    /**
+     * Get the number of failed writes, including failures to open the sysfs node.
+     *
+     * @return uint64_t The number of failed writes
+     */
+    uint64_t getErrorCount() const;
+
+    void dump(int fd) const override;
+
+  private:
+    struct State {
+        std::mutex mutex;
+        ::android::base::unique_fd fd;
+        std::optional<std::string> value;
+        uint64_t writeCount = 0;
+        uint64_t skippedWriteCount = 0;
+        uint64_t errorCount = 0;
+        LatencyHistogram writeLatency;
+    };
+
+    std::string mPath;
+    bool mSkipUnchanged;
+    std::shared_ptr<State> mState;
+};
+
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -6,6 +6,11 @@
 
 #include "Utils.h"
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -48,6 +53,40 @@ uint32_t scaleBrightness(uint8_t brightness, uint32_t maxBrightness) {
     return brightness * maxBrightness / 0xFF;
 }
 
+std::set<std::string> listFiles(const std::string& path) {
+    std::set<std::string> files;
+
+    int dirFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        return files;
+    }
+
+    // Takes ownership of dirFd
+    DIR* dir = fdopendir(dirFd);
+    if (dir == nullptr) {
+        close(dirFd);
+        return files;
+    }
+
+    while (struct dirent* entry = readdir(dir)) {
+        struct stat st;
+        if (entry->d_type == DT_REG) {
+            files.emplace(entry->d_name);
+        } else if ((entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN) &&
+                   fstatat(dirFd, entry->d_name, &st, 0) == 0 && S_ISREG(st.st_mode)) {
+            files.emplace(entry->d_name);
+        }
+    }
+
+    closedir(dir);
+    return files;
+}
+
+bool isFile(const std::string& path) {
+    struct stat st;
+    return fstatat(AT_FDCWD, path.c_str(), &st, 0) == 0 && S_ISREG(st.st_mode);
+}
+
 }  // namespace light
 }  // namespace hardware
 }  // namespace android
@@ -6,8 +6,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <fstream>
+#include <set>
 #include <string>
 
 namespace aidl {
@@ -30,6 +32,42 @@ struct rgb {
 
 uint32_t scaleBrightness(uint8_t brightness, uint32_t maxBrightness);
 
+/**
+ * std::atomic<uint64_t> counter that can be copied, so that the devices holding one stay
+ * copyable while they are probed. A copy starts from the value of the original.
+ */
+class AtomicCounter {
+  public:
+    AtomicCounter() : mValue(0) {}
+    AtomicCounter(const AtomicCounter& other) : mValue(other.load()) {}
+    AtomicCounter& operator=(const AtomicCounter& other) {
+        mValue = other.load();
+        return *this;
+    }
+
+    void operator++(int) { mValue.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t load() const { return mValue.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<uint64_t> mValue;
+};
+
+/**
+ * List the regular files in a directory, following symlinks, with a single scan of it.
+ *
+ * @param path The path of the directory
+ * @return std::set<std::string> The names of the files, empty if the directory doesn't exist
+ */
+std::set<std::string> listFiles(const std::string& path);
+
+/**
+ * Return whether a path is a regular file, following symlinks.
+ *
+ * @param path The path to check
+ * @return bool true if the path is a regular file, false otherwise
+ */
+bool isFile(const std::string& path);
+
 template <typename T>
 bool readFromFile(const std::string& file, T& content) {
     std::ifstream fileStream(file);
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include "BacklightWriter.h"
+#include "Devices.h"
+
+using aidl::android::hardware::light::BacklightWriter;
+using aidl::android::hardware::light::Devices;
+using aidl::android::hardware::light::rgb;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Native levels of the fake panel
+constexpr uint32_t kMaxBrightness = 2047;
+
+// The framework animates brightness once per frame
+constexpr auto kFrameInterval = std::chrono::microseconds(16667);
+
+// Transitions go back and forth between these 8-bit levels
+constexpr uint8_t kLowLevel = 64;
+constexpr uint8_t kHighLevel = 192;
+
+/*
+ * A backlight class directory with a single panel0-backlight device, the brightness node being
+ * a plain file.
+ */
+class FakeBacklight {
+  public:
+    FakeBacklight() {
+        const std::string device = std::string(mDir.path) + "/panel0-backlight";
+        mkdir(device.c_str(), 0755);
+        std::ofstream(device + "/brightness") << 0;
+        std::ofstream(device + "/max_brightness") << kMaxBrightness;
+    }
+
+    std::string getClassPath() const { return std::string(mDir.path) + "/"; }
+
+  private:
+    TemporaryDir mDir;
+};
+
+rgb gray(uint8_t level) {
+    return rgb(level, level, level);
+}
+
+/*
+ * Brightness transitions of the given duration, either animated by the framework with one
+ * setLightState call per frame and no HAL ramp (mode 0), or a single call ramped by the HAL
+ * (mode 1). Reports setLightState calls and sysfs writes per transition, and the time spent in
+ * the calls, which is what the binder thread pays.
+ */
+void BM_BacklightTransition(benchmark::State& state) {
+    const bool halRamp = state.range(0);
+    const auto duration = std::chrono::milliseconds(state.range(1));
+
+    FakeBacklight backlight;
+    Devices devices(backlight.getClassPath());
+    BacklightWriter writer(devices, halRamp ? duration : std::chrono::milliseconds::zero(),
+                           BacklightWriter::RampCurve::LINEAR);
+
+    // Start from the low level, ramps are never applied when turning on
+    writer.post(gray(kLowLevel));
+    std::this_thread::sleep_for(kFrameInterval);
+
+    const uint64_t startRequests = writer.getRequestCount();
+    const uint64_t startWrites = writer.getWriteCount();
+    Clock::duration callTime{0};
+    bool rising = true;
+
+    for (auto _ : state) {
+        const uint8_t from = rising ? kLowLevel : kHighLevel;
+        const uint8_t to = rising ? kHighLevel : kLowLevel;
+        rising = !rising;
+
+        const Clock::time_point start = Clock::now();
+        if (halRamp) {
+            const Clock::time_point callStart = Clock::now();
+            writer.post(gray(to));
+            callTime += Clock::now() - callStart;
+        } else {
+            const int frames = duration / kFrameInterval;
+            for (int frame = 1; frame <= frames; frame++) {
+                std::this_thread::sleep_until(start + frame * kFrameInterval);
+                const uint8_t level = from + (to - from) * frame / frames;
+
+                const Clock::time_point callStart = Clock::now();
+                writer.post(gray(level));
+                callTime += Clock::now() - callStart;
+            }
+        }
+
+        // Let the transition and the writes behind it complete
+        std::this_thread::sleep_until(start + duration + 2 * kFrameInterval);
+    }
+
+    state.counters["calls"] = benchmark::Counter(writer.getRequestCount() - startRequests,
+                                                 benchmark::Counter::kAvgIterations);
+    state.counters["writes"] = benchmark::Counter(writer.getWriteCount() - startWrites,
+                                                  benchmark::Counter::kAvgIterations);
+    state.counters["call_us"] = benchmark::Counter(
+            std::chrono::duration<double, std::micro>(callTime).count(),
+            benchmark::Counter::kAvgIterations);
+}
+
+}  // namespace
+
+BENCHMARK(BM_BacklightTransition)
+        ->ArgNames({"hal_ramp", "ms"})
+        ->ArgsProduct({{0, 1}, {250, 500}})
+        ->Iterations(8)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -15,6 +15,8 @@
  */
 
 #include "HalProxy.h"
+#include "SensorTrace.h"
+#include "SubHalExecutor.h"
 
 #include <android/hardware/sensors/2.0/types.h>
 
@@ -40,12 +42,158 @@ using ::android::hardware::sensors::V2_0::EventQueueFlagBits;
 using ::android::hardware::sensors::V2_0::WakeLockQueueFlagBits;
 using ::android::hardware::sensors::V2_0::implementation::getTimeNow;
 using ::android::hardware::sensors::V2_0::implementation::kWakelockTimeoutNs;
+using ::android::hardware::sensors::trace::SensorTraceWriter;
 
 typedef V2_0::implementation::ISensorsSubHal*(SensorsHalGetSubHalFunc)(uint32_t*);
 typedef V2_1::implementation::ISensorsSubHal*(SensorsHalGetSubHalV2_1Func)(uint32_t*);
 
 static constexpr int32_t kBitsAfterSubHalIndex = 24;
 
+// HalProxy.h comes with the multihal headers the AIDL wrapper is built against, so its layout
+// can't change; there is a single proxy per process. Guarded by mEventQueueWriteMutex.
+static SensorTraceWriter sTraceWriter;
+
+// Events of wake-up and one-shot sensors, written ahead of mPendingWriteEventsQueue and never
+// dropped. Past kMaxSizePriorityWriteEventsQueue, new ones spill to mPendingWriteEventsQueue and
+// its backpressure, so a framework that stopped reading can't grow it without bound. Same locking
+// as above.
+static constexpr size_t kMaxSizePriorityWriteEventsQueue = 200000;
+static std::queue<std::pair<std::vector<Event>, size_t>> sPriorityWriteEventsQueue;
+static size_t sSizePriorityWriteEventsQueue = 0;
+static size_t sMostEventsObservedPriorityWriteEventsQueue = 0;
+static uint64_t sSpilledPriorityEventCount = 0;
+// The FMQ has a single writer, set while the pending writes thread writes without the lock
+static bool sPendingWriteInProgress = false;
+
+// Backpressure applied to the chunk at the front of mPendingWriteEventsQueue when blocking writes
+// time out. Level n keeps 1 in 2^n continuous samples of the chunk, past kMaxDecimationLevel
+// droppable events go. Each timeout raises the level by at least one, and straight to what the
+// fill of mPendingWriteEventsQueue calls for. Same locking as above.
+static constexpr size_t kMaxDecimationLevel = 2;
+static size_t sBackpressureLevel = 0;
+// Timeouts in a row with nothing left to thin out before giving up on a chunk, either lane
+static constexpr size_t kMaxWriteRetries = 3;
+static size_t sWriteRetryCount = 0;
+static uint64_t sDecimatedEventCount = 0;
+static uint64_t sDroppedEventCount = 0;
+
+// One executor per sub-HAL, indexed like mSubHalList and created on first use
+static std::mutex sSubHalExecutorsMutex;
+static std::vector<std::unique_ptr<SubHalExecutor>> sSubHalExecutors;
+
+static SubHalExecutor& getSubHalExecutor(
+        const std::vector<std::shared_ptr<ISubHalWrapperBase>>& subHalList, size_t subHalIndex) {
+    std::lock_guard<std::mutex> lock(sSubHalExecutorsMutex);
+    if (sSubHalExecutors.size() < subHalList.size()) {
+        sSubHalExecutors.resize(subHalList.size());
+    }
+
+    std::unique_ptr<SubHalExecutor>& executor = sSubHalExecutors[subHalIndex];
+    if (executor == nullptr) {
+        executor = std::make_unique<SubHalExecutor>(subHalList[subHalIndex]->getName());
+    }
+    return *executor;
+}
+
+/**
+ * Whether the events of a sensor go through the priority lane: wake-up sensors, which hold a
+ * wakelock until read, and one-shot sensors like gestures, which report once per trigger.
+ * Flush complete events carry the handle of the flushed sensor, so they follow its data.
+ */
+static bool isPrioritySensor(const std::map<int32_t, SensorInfo>& sensors, int32_t sensorHandle) {
+    auto it = sensors.find(sensorHandle);
+    if (it == sensors.end()) {
+        return false;
+    }
+
+    const uint32_t flags = it->second.flags;
+    return (flags & static_cast<uint32_t>(V1_0::SensorFlagBits::WAKE_UP)) ||
+           (flags & static_cast<uint32_t>(V1_0::SensorFlagBits::MASK_REPORTING_MODE)) ==
+                   static_cast<uint32_t>(V1_0::SensorFlagBits::ONE_SHOT_MODE);
+}
+
+/**
+ * Backpressure level called for by the fill of the pending writes queue, from 1 when nearly
+ * empty up to kMaxDecimationLevel + 1, dropping, when full.
+ */
+static size_t getBackpressureLevel(size_t queueSize, size_t maxQueueSize) {
+    const size_t level = 1 + queueSize * (kMaxDecimationLevel + 1) / (maxQueueSize + 1);
+    return std::min(level, kMaxDecimationLevel + 1);
+}
+
+/**
+ * Backpressure policy for the first numEvents events of a chunk the framework didn't read in time.
+ * With a decimation factor, continuous non-wake-up sensors keep every factor-th sample along with
+ * their first and last one, and other events are untouched. Without, everything goes but meta data
+ * events, dynamic sensor connections and one-shot events.
+ *
+ * @return The number of events removed.
+ */
+static size_t applyBackpressure(const std::map<int32_t, SensorInfo>& sensors,
+                                std::vector<Event>& events, size_t numEvents,
+                                size_t decimationFactor, size_t* numWakeupEventsRemoved) {
+    auto getFlags = [&](const Event& event) -> uint32_t {
+        auto it = sensors.find(event.sensorHandle);
+        return it != sensors.end() ? it->second.flags : 0;
+    };
+    auto getReportingMode = [&](const Event& event) -> uint32_t {
+        return getFlags(event) & static_cast<uint32_t>(V1_0::SensorFlagBits::MASK_REPORTING_MODE);
+    };
+    auto isMetaData = [](const Event& event) {
+        return event.sensorType == SensorType::META_DATA ||
+               event.sensorType == SensorType::DYNAMIC_SENSOR_META ||
+               event.sensorType == SensorType::ADDITIONAL_INFO;
+    };
+    auto isDecimated = [&](const Event& event) {
+        return !isMetaData(event) && sensors.count(event.sensorHandle) > 0 &&
+               !(getFlags(event) & static_cast<uint32_t>(V1_0::SensorFlagBits::WAKE_UP)) &&
+               getReportingMode(event) ==
+                       static_cast<uint32_t>(V1_0::SensorFlagBits::CONTINUOUS_MODE);
+    };
+    auto isPreserved = [&](const Event& event) {
+        return event.sensorType == SensorType::META_DATA ||
+               event.sensorType == SensorType::DYNAMIC_SENSOR_META ||
+               (!isMetaData(event) &&
+                getReportingMode(event) ==
+                        static_cast<uint32_t>(V1_0::SensorFlagBits::ONE_SHOT_MODE));
+    };
+
+    std::map<int32_t, size_t> sampleCounts;
+    if (decimationFactor > 0) {
+        for (size_t i = 0; i < numEvents; i++) {
+            if (isDecimated(events[i])) {
+                sampleCounts[events[i].sensorHandle]++;
+            }
+        }
+    }
+
+    std::map<int32_t, size_t> sampleIndexes;
+    size_t numKept = 0;
+    *numWakeupEventsRemoved = 0;
+    for (size_t i = 0; i < numEvents; i++) {
+        const Event& event = events[i];
+        bool keep = true;
+        if (decimationFactor == 0) {
+            keep = isPreserved(event);
+        } else if (isDecimated(event)) {
+            const size_t index = sampleIndexes[event.sensorHandle]++;
+            keep = index % decimationFactor == 0 || index == sampleCounts[event.sensorHandle] - 1;
+        }
+
+        if (keep) {
+            if (numKept != i) {
+                events[numKept] = event;
+            }
+            numKept++;
+        } else if (getFlags(event) & static_cast<uint32_t>(V1_0::SensorFlagBits::WAKE_UP)) {
+            (*numWakeupEventsRemoved)++;
+        }
+    }
+    events.erase(events.begin() + numKept, events.begin() + numEvents);
+
+    return numEvents - numKept;
+}
+
 /**
  * Set the subhal index as first byte of sensor handle and return this modified version.
  *
@@ -133,6 +281,9 @@ HalProxy::HalProxy(std::vector<ISensorsSubHalV2_0*>& subHalList,
 
 HalProxy::~HalProxy() {
     stopThreads();
+
+    std::lock_guard<std::mutex> lock(sSubHalExecutorsMutex);
+    sSubHalExecutors.clear();
 }
 
 Return<void> HalProxy::getSensorsList_2_1(ISensorsV2_1::getSensorsList_2_1_cb _hidl_cb) {
@@ -156,21 +307,44 @@ Return<void> HalProxy::getSensorsList(ISensorsV2_0::getSensorsList_cb _hidl_cb)
 }
 
 Return<Result> HalProxy::setOperationMode(OperationMode mode) {
+    // Switch all the subhals at once, each on its own executor
+    std::vector<std::future<Result>> results;
+    for (size_t subHalIndex = 0; subHalIndex < mSubHalList.size(); subHalIndex++) {
+        std::shared_ptr<ISubHalWrapperBase> subHal = mSubHalList[subHalIndex];
+        results.push_back(getSubHalExecutor(mSubHalList, subHalIndex)
+                                  .post<Result>("setOperationMode", [subHal, mode] {
+                                      return subHal->setOperationMode(mode);
+                                  }));
+    }
+
     Result result = Result::OK;
-    size_t subHalIndex;
-    for (subHalIndex = 0; subHalIndex < mSubHalList.size(); subHalIndex++) {
-        result = mSubHalList[subHalIndex]->setOperationMode(mode);
-        if (result != Result::OK) {
+    std::vector<size_t> flippedSubHals;
+    for (size_t subHalIndex = 0; subHalIndex < results.size(); subHalIndex++) {
+        Result subHalResult = results[subHalIndex].get();
+        if (subHalResult == Result::OK) {
+            flippedSubHals.push_back(subHalIndex);
+        } else {
             ALOGE("setOperationMode failed for SubHal: %s",
                   mSubHalList[subHalIndex]->getName().c_str());
-            break;
+            if (result == Result::OK) {
+                result = subHalResult;
+            }
         }
     }
 
     if (result != Result::OK) {
         // Reset the subhal operation modes that have been flipped
-        for (size_t i = 0; i < subHalIndex; i++) {
-            mSubHalList[i]->setOperationMode(mCurrentOperationMode);
+        std::vector<std::future<void>> resets;
+        for (size_t subHalIndex : flippedSubHals) {
+            std::shared_ptr<ISubHalWrapperBase> subHal = mSubHalList[subHalIndex];
+            OperationMode currentMode = mCurrentOperationMode;
+            resets.push_back(getSubHalExecutor(mSubHalList, subHalIndex)
+                                     .post<void>("setOperationMode", [subHal, currentMode] {
+                                         subHal->setOperationMode(currentMode);
+                                     }));
+        }
+        for (std::future<void>& reset : resets) {
+            reset.wait();
         }
     } else {
         mCurrentOperationMode = mode;
@@ -380,6 +554,33 @@ Return<void> HalProxy::debug(const hidl_handle& fd, const hidl_vec<hidl_string>&
     int writeFd = fd->data[0];
 
     std::ostringstream stream;
+    if (args.size() >= 2 && args[0] == "--trace-record") {
+        std::vector<SensorInfo> sensors;
+        for (const auto& [handle, sensor] : mSensors) {
+            sensors.push_back(sensor);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mDynamicSensorsMutex);
+            for (const auto& [handle, sensor] : mDynamicSensors) {
+                sensors.push_back(sensor);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+        const bool success = sTraceWriter.open(args[1], sensors);
+        stream << (success ? "Recording events to " : "Failed to record events to ")
+               << args[1].c_str() << std::endl;
+        android::base::WriteStringToFd(stream.str(), writeFd);
+        return Return<void>();
+    } else if (args.size() >= 1 && args[0] == "--trace-stop") {
+        std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+        sTraceWriter.close();
+        stream << "Stopped recording after " << sTraceWriter.getEventCount() << " events, "
+               << sTraceWriter.getDroppedEventCount() << " dropped" << std::endl;
+        android::base::WriteStringToFd(stream.str(), writeFd);
+        return Return<void>();
+    }
+
     stream << "===HalProxy===" << std::endl;
     stream << "Internal values:" << std::endl;
     stream << "  Threads are running: " << (mThreadsRun.load() ? "true" : "false") << std::endl;
@@ -398,8 +599,41 @@ Return<void> HalProxy::debug(const hidl_handle& fd, const hidl_vec<hidl_string>&
         stream << "  Size of events list on front of pending writes queue: "
                << mPendingWriteEventsQueue.front().first.size() << std::endl;
     }
+    {
+        std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+        stream << "  # of events on priority writes queue: " << sSizePriorityWriteEventsQueue
+               << std::endl;
+        stream << "  Most events seen on priority writes queue: "
+               << sMostEventsObservedPriorityWriteEventsQueue << std::endl;
+        stream << "  # of priority events spilled to pending writes queue: "
+               << sSpilledPriorityEventCount << std::endl;
+        stream << "  Backpressure level: " << sBackpressureLevel << std::endl;
+        stream << "  # of events decimated under backpressure: " << sDecimatedEventCount
+               << std::endl;
+        stream << "  # of events dropped: " << sDroppedEventCount << std::endl;
+    }
     stream << "  # of non-dynamic sensors across all subhals: " << mSensors.size() << std::endl;
     stream << "  # of dynamic sensors across all subhals: " << mDynamicSensors.size() << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+        stream << "  Event trace: "
+               << (sTraceWriter.isOpen() ? "recording" : "off (--trace-record <path>)")
+               << std::endl;
+        if (sTraceWriter.isOpen()) {
+            stream << "  # of events traced: " << sTraceWriter.getEventCount() << ", dropped: "
+                   << sTraceWriter.getDroppedEventCount() << std::endl;
+        }
+    }
+    stream << "SubHal calls:" << std::endl;
+    {
+        // Only the executors already in use, dumping shouldn't start threads
+        std::lock_guard<std::mutex> lock(sSubHalExecutorsMutex);
+        for (const auto& executor : sSubHalExecutors) {
+            if (executor != nullptr) {
+                executor->dump(stream);
+            }
+        }
+    }
     stream << "SubHals (" << mSubHalList.size() << "):" << std::endl;
     for (auto& subHal : mSubHalList) {
         stream << "  Name: " << subHal->getName() << std::endl;
@@ -579,14 +813,31 @@ void HalProxy::stopThreads() {
 }
 
 void HalProxy::disableAllSensors() {
+    std::vector<int32_t> sensorHandles;
     for (const auto& sensorEntry : mSensors) {
-        int32_t sensorHandle = sensorEntry.first;
-        activate(sensorHandle, false /* enabled */);
+        sensorHandles.push_back(sensorEntry.first);
     }
-    std::lock_guard<std::mutex> dynamicSensorsLock(mDynamicSensorsMutex);
-    for (const auto& sensorEntry : mDynamicSensors) {
-        int32_t sensorHandle = sensorEntry.first;
-        activate(sensorHandle, false /* enabled */);
+    {
+        std::lock_guard<std::mutex> dynamicSensorsLock(mDynamicSensorsMutex);
+        for (const auto& sensorEntry : mDynamicSensors) {
+            sensorHandles.push_back(sensorEntry.first);
+        }
+    }
+
+    // Subhals deactivate their sensors in parallel, one after the other within each
+    std::vector<std::future<void>> deactivations;
+    for (int32_t sensorHandle : sensorHandles) {
+        if (!isSubHalIndexValid(sensorHandle)) {
+            continue;
+        }
+        deactivations.push_back(
+                getSubHalExecutor(mSubHalList, extractSubHalIndex(sensorHandle))
+                        .post<void>("activate", [this, sensorHandle] {
+                            activate(sensorHandle, false /* enabled */);
+                        }));
+    }
+    for (std::future<void>& deactivation : deactivations) {
+        deactivation.wait();
     }
 }
 
@@ -599,38 +850,107 @@ void HalProxy::handlePendingWrites() {
     // one.
     std::unique_lock<std::mutex> lock(mEventQueueWriteMutex);
     while (mThreadsRun.load()) {
-        mEventQueueWriteCV.wait(
-                lock, [&] { return !mPendingWriteEventsQueue.empty() || !mThreadsRun.load(); });
+        mEventQueueWriteCV.wait(lock, [&] {
+            return !sPriorityWriteEventsQueue.empty() || !mPendingWriteEventsQueue.empty() ||
+                   !mThreadsRun.load();
+        });
         if (mThreadsRun.load()) {
-            std::vector<Event>& pendingWriteEvents = mPendingWriteEventsQueue.front().first;
-            size_t numWakeupEvents = mPendingWriteEventsQueue.front().second;
+            // The priority lane is always drained first
+            const bool priority = !sPriorityWriteEventsQueue.empty();
+            auto& writeEventsQueue =
+                    priority ? sPriorityWriteEventsQueue : mPendingWriteEventsQueue;
+            std::vector<Event>& pendingWriteEvents = writeEventsQueue.front().first;
             size_t eventQueueSize = mEventQueue->getQuantumCount();
             size_t numToWrite = std::min(pendingWriteEvents.size(), eventQueueSize);
+            sPendingWriteInProgress = true;
             lock.unlock();
             if (!mEventQueue->writeBlocking(
                         pendingWriteEvents.data(), numToWrite,
                         static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
                         static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS),
                         kPendingWriteTimeoutNs, mEventQueueFlag)) {
-                ALOGE("Dropping %zu events after blockingWrite failed.", numToWrite);
-                if (numWakeupEvents > 0) {
-                    if (pendingWriteEvents.size() > eventQueueSize) {
-                        decrementRefCountAndMaybeReleaseWakelock(
-                                countNumWakeupEvents(pendingWriteEvents, eventQueueSize));
+                lock.lock();
+                sPendingWriteInProgress = false;
+
+                const size_t numEvents = pendingWriteEvents.size();
+                size_t numRemoved = 0;
+                size_t numWakeupEventsRemoved = 0;
+                if (!priority && sBackpressureLevel <= kMaxDecimationLevel) {
+                    // Thin the chunk out rather than dropping it whole, then retry what is left
+                    const size_t level = std::max(
+                            sBackpressureLevel + 1,
+                            getBackpressureLevel(mSizePendingWriteEventsQueue,
+                                                 kMaxSizePendingWriteEventsQueue));
+                    // The chunk is already down to 1 in 2^sBackpressureLevel samples, so only
+                    // the difference applies
+                    const size_t decimationFactor =
+                            level <= kMaxDecimationLevel ? size_t(1) << (level - sBackpressureLevel)
+                                                         : 0;
+                    numRemoved = applyBackpressure(mSensors, pendingWriteEvents, numEvents,
+                                                   decimationFactor, &numWakeupEventsRemoved);
+                    if (decimationFactor > 0) {
+                        ALOGE("Decimating %zu of %zu events to level %zu after blockingWrite "
+                              "failed.",
+                              numRemoved, numEvents, level);
+                        sDecimatedEventCount += numRemoved;
                     } else {
-                        decrementRefCountAndMaybeReleaseWakelock(numWakeupEvents);
+                        ALOGE("Dropping %zu of %zu events after blockingWrite failed.",
+                              numRemoved, numEvents);
+                        sDroppedEventCount += numRemoved;
+                    }
+                    sBackpressureLevel = std::min(level, kMaxDecimationLevel + 1);
+                } else if (++sWriteRetryCount <= kMaxWriteRetries) {
+                    // Keep them, and their wakelock references, for a few more tries
+                    ALOGE("Retrying %zu %s events after blockingWrite failed.", numEvents,
+                          priority ? "priority" : "preserved");
+                    continue;
+                } else {
+                    // The framework isn't reading, don't hold everything behind them forever
+                    ALOGE("Dropping %zu %s events after %zu blockingWrite failures.", numEvents,
+                          priority ? "priority" : "preserved", sWriteRetryCount);
+                    numRemoved = numEvents;
+                    numWakeupEventsRemoved =
+                            std::min(writeEventsQueue.front().second,
+                                     countNumWakeupEvents(pendingWriteEvents, numEvents));
+                    pendingWriteEvents.clear();
+                    sDroppedEventCount += numRemoved;
+                    sWriteRetryCount = 0;
+                }
+
+                if (priority) {
+                    sSizePriorityWriteEventsQueue -= numRemoved;
+                } else {
+                    mSizePendingWriteEventsQueue -= numRemoved;
+                }
+                if (pendingWriteEvents.empty()) {
+                    writeEventsQueue.pop();
+                    if (!priority) {
+                        sBackpressureLevel = 0;
                     }
                 }
+                if (numWakeupEventsRemoved > 0) {
+                    decrementRefCountAndMaybeReleaseWakelock(numWakeupEventsRemoved);
+                }
+                continue;
             }
             lock.lock();
-            mSizePendingWriteEventsQueue -= numToWrite;
+            sPendingWriteInProgress = false;
+            sWriteRetryCount = 0;
+            if (priority) {
+                sSizePriorityWriteEventsQueue -= numToWrite;
+            } else {
+                mSizePendingWriteEventsQueue -= numToWrite;
+            }
             if (pendingWriteEvents.size() > eventQueueSize) {
                 // TODO(b/143302327): Check if this erase operation is too inefficient. It will copy
                 // all the events ahead of it down to fill gap off array at front after the erase.
                 pendingWriteEvents.erase(pendingWriteEvents.begin(),
                                          pendingWriteEvents.begin() + eventQueueSize);
             } else {
-                mPendingWriteEventsQueue.pop();
+                writeEventsQueue.pop();
+                if (!priority) {
+                    sBackpressureLevel = 0;
+                }
             }
         }
     }
@@ -685,32 +1005,100 @@ void HalProxy::resetSharedWakelock() {
 
 void HalProxy::postEventsToMessageQueue(const std::vector<Event>& events, size_t numWakeupEvents,
                                         V2_0::implementation::ScopedWakelock wakelock) {
-    size_t numToWrite = 0;
+    static_assert(kMaxSizePriorityWriteEventsQueue > kMaxSizePendingWriteEventsQueue,
+                  "The priority lane must hold more than the bulk lane before spilling");
+
     std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+    sTraceWriter.append(events);
     if (wakelock.isLocked()) {
         incrementRefCountAndMaybeAcquireWakelock(numWakeupEvents);
     }
-    if (mPendingWriteEventsQueue.empty()) {
-        numToWrite = std::min(events.size(), mEventQueue->availableToWrite());
-        if (numToWrite > 0) {
-            if (mEventQueue->write(events.data(), numToWrite)) {
-                // TODO(b/143302327): While loop if mEventQueue->avaiableToWrite > 0 to possibly fit
-                // in more writes immediately
-                mEventQueueFlag->wake(static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
-            } else {
-                numToWrite = 0;
+
+    // Writes what fits right away unless events are already waiting ahead, then hands the rest to
+    // the pending writes thread. Bulk data waits behind both lanes, priority events only behind
+    // their own lane.
+    auto postLane = [&](const std::vector<Event>& laneEvents, size_t laneWakeupEvents,
+                        bool priority) {
+        size_t numToWrite = 0;
+        if (!sPendingWriteInProgress && sPriorityWriteEventsQueue.empty() &&
+            (priority || mPendingWriteEventsQueue.empty())) {
+            numToWrite = std::min(laneEvents.size(), mEventQueue->availableToWrite());
+            if (numToWrite > 0) {
+                if (mEventQueue->write(laneEvents.data(), numToWrite)) {
+                    // TODO(b/143302327): While loop if mEventQueue->avaiableToWrite > 0 to
+                    // possibly fit in more writes immediately
+                    mEventQueueFlag->wake(
+                            static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
+                } else {
+                    numToWrite = 0;
+                }
             }
         }
-    }
-    size_t numLeft = events.size() - numToWrite;
-    if (numToWrite < events.size() &&
-        mSizePendingWriteEventsQueue + numLeft <= kMaxSizePendingWriteEventsQueue) {
-        std::vector<Event> eventsLeft(events.begin() + numToWrite, events.end());
-        mPendingWriteEventsQueue.push({eventsLeft, numWakeupEvents});
-        mSizePendingWriteEventsQueue += numLeft;
-        mMostEventsObservedPendingWriteEventsQueue =
-                std::max(mMostEventsObservedPendingWriteEventsQueue, mSizePendingWriteEventsQueue);
+        size_t numLeft = laneEvents.size() - numToWrite;
+        if (numLeft == 0) {
+            return;
+        }
+        std::vector<Event> eventsLeft(laneEvents.begin() + numToWrite, laneEvents.end());
+        if (priority &&
+            sSizePriorityWriteEventsQueue + numLeft > kMaxSizePriorityWriteEventsQueue) {
+            // Events of these sensors posted once the lane has room again may overtake these
+            ALOGW("Priority writes queue full, spilling %zu events", numLeft);
+            sSpilledPriorityEventCount += numLeft;
+            priority = false;
+        }
+        if (priority) {
+            sPriorityWriteEventsQueue.push({eventsLeft, laneWakeupEvents});
+            sSizePriorityWriteEventsQueue += numLeft;
+            sMostEventsObservedPriorityWriteEventsQueue = std::max(
+                    sMostEventsObservedPriorityWriteEventsQueue, sSizePriorityWriteEventsQueue);
+        } else if (mSizePendingWriteEventsQueue + numLeft <= kMaxSizePendingWriteEventsQueue) {
+            mPendingWriteEventsQueue.push({eventsLeft, laneWakeupEvents});
+            mSizePendingWriteEventsQueue += numLeft;
+            mMostEventsObservedPendingWriteEventsQueue = std::max(
+                    mMostEventsObservedPendingWriteEventsQueue, mSizePendingWriteEventsQueue);
+        } else {
+            sDroppedEventCount += numLeft;
+            // Wake-up events already written are acknowledged by the framework
+            const size_t numWakeupEventsLeft =
+                    std::min(laneWakeupEvents, countNumWakeupEvents(eventsLeft, numLeft));
+            if (numWakeupEventsLeft > 0) {
+                decrementRefCountAndMaybeReleaseWakelock(numWakeupEventsLeft);
+            }
+            return;
+        }
         mEventQueueWriteCV.notify_one();
+    };
+
+    size_t numPriorityEvents = 0;
+    for (const Event& event : events) {
+        if (isPrioritySensor(mSensors, event.sensorHandle)) {
+            numPriorityEvents++;
+        }
+    }
+
+    if (numPriorityEvents == 0) {
+        postLane(events, numWakeupEvents, false);
+    } else if (numPriorityEvents == events.size()) {
+        postLane(events, numWakeupEvents, true);
+    } else {
+        // Events of a sensor all take the same lane, so their order is kept
+        std::vector<Event> priorityEvents;
+        std::vector<Event> bulkEvents;
+        priorityEvents.reserve(numPriorityEvents);
+        bulkEvents.reserve(events.size() - numPriorityEvents);
+        for (const Event& event : events) {
+            if (isPrioritySensor(mSensors, event.sensorHandle)) {
+                priorityEvents.push_back(event);
+            } else {
+                bulkEvents.push_back(event);
+            }
+        }
+
+        // Wake-up sensors unknown to mSensors, i.e. dynamic ones, stay on the bulk lane
+        size_t numPriorityWakeupEvents =
+                std::min(numWakeupEvents, countNumWakeupEvents(priorityEvents, numPriorityEvents));
+        postLane(priorityEvents, numPriorityWakeupEvents, true);
+        postLane(bulkEvents, numWakeupEvents - numPriorityWakeupEvents, false);
     }
 }
 
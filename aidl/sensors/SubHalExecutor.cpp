@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "SubHalExecutor.h"
+
+#include <log/log.h>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+static double msFromDuration(SubHalExecutor::Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+SubHalExecutor::SubHalExecutor(const std::string& name) : mName(name), mExiting(false) {
+    mThread = std::thread(&SubHalExecutor::threadLoop, this);
+}
+
+SubHalExecutor::~SubHalExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExiting = true;
+    }
+    mCondition.notify_all();
+    mThread.join();
+}
+
+void SubHalExecutor::enqueue(const char* call, std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCalls.push({call, std::move(fn), Clock::now()});
+    }
+    mCondition.notify_one();
+}
+
+void SubHalExecutor::threadLoop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    // Calls still queued on exit are run, their callers may be waiting on them
+    while (!mExiting || !mCalls.empty()) {
+        mCondition.wait(lock, [&] { return mExiting || !mCalls.empty(); });
+        if (mCalls.empty()) {
+            continue;
+        }
+
+        Call call = std::move(mCalls.front());
+        mCalls.pop();
+        lock.unlock();
+
+        const Clock::time_point start = Clock::now();
+        call.fn();
+        const Clock::time_point end = Clock::now();
+
+        const Clock::duration runTime = end - start;
+        const bool slow = runTime > kSlowCallThreshold;
+        if (slow) {
+            ALOGW("SubHal %s took %.1f ms for %s", mName.c_str(), msFromDuration(runTime),
+                  call.name);
+        }
+
+        {
+            std::lock_guard<std::mutex> statsLock(mStatsMutex);
+            CallStats& stats = mStats[call.name];
+            stats.count++;
+            stats.slowCount += slow ? 1 : 0;
+            stats.totalQueueTime += start - call.postTime;
+            stats.totalRunTime += runTime;
+            stats.maxRunTime = std::max(stats.maxRunTime, runTime);
+        }
+
+        lock.lock();
+    }
+}
+
+void SubHalExecutor::dump(std::ostream& stream) {
+    size_t pending;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        pending = mCalls.size();
+    }
+
+    std::lock_guard<std::mutex> statsLock(mStatsMutex);
+    stream << "  " << mName << " (" << pending << " calls pending):" << std::endl;
+    for (const auto& [name, stats] : mStats) {
+        stream << "    " << name << ": " << stats.count << " calls, avg "
+               << msFromDuration(stats.totalRunTime / stats.count) << " ms, max "
+               << msFromDuration(stats.maxRunTime) << " ms, avg queued "
+               << msFromDuration(stats.totalQueueTime / stats.count) << " ms" << std::endl;
+        if (stats.slowCount > 0) {
+            stream << "    WARNING: " << stats.slowCount << " " << name << " calls took over "
+                   << kSlowCallThreshold.count() << " ms" << std::endl;
+        }
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <queue>
+#include <string>
+#include <thread>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+/*
+ * Runs the calls made to one sub-HAL on its own thread, in the order they were posted, so that a
+ * slow sub-HAL doesn't hold up the others. Keeps latency statistics per call.
+ */
+class SubHalExecutor {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // Calls taking longer than this get logged and reported by dump()
+    static constexpr std::chrono::milliseconds kSlowCallThreshold{100};
+
+    explicit SubHalExecutor(const std::string& name);
+    ~SubHalExecutor();
+
+    /*
+     * Queues fn after the calls already posted, the returned future becomes ready once it ran.
+     * call names the operation in the statistics and must be a string literal.
+     */
+    template <typename T>
+    std::future<T> post(const char* call, std::function<T()> fn) {
+        auto task = std::make_shared<std::packaged_task<T()>>(std::move(fn));
+        std::future<T> future = task->get_future();
+        enqueue(call, [task] { (*task)(); });
+        return future;
+    }
+
+    void dump(std::ostream& stream);
+
+  private:
+    struct Call {
+        const char* name;
+        std::function<void()> fn;
+        Clock::time_point postTime;
+    };
+
+    struct CallStats {
+        uint64_t count = 0;
+        uint64_t slowCount = 0;
+        Clock::duration totalQueueTime{0};
+        Clock::duration totalRunTime{0};
+        Clock::duration maxRunTime{0};
+    };
+
+    void enqueue(const char* call, std::function<void()> fn);
+    void threadLoop();
+
+    const std::string mName;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::queue<Call> mCalls;
+    bool mExiting;
+
+    std::mutex mStatsMutex;
+    std::map<std::string, CallStats> mStats;
+
+    std::thread mThread;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -14,9 +14,13 @@
 #include "BiometricsFingerprint.h"
 #include "UdfpsHandler.h"
 
+#include <android-base/file.h>
 #include <android-base/properties.h>
 #include <inttypes.h>
 #include <unistd.h>
+#include <chrono>
+#include <sstream>
+#include <vector>
 
 namespace {
 
@@ -30,6 +34,19 @@ static const fingerprint_hal_t kModules[] = {
         {"goodix_fod", true}, {"goodix_fod6", true}, {"silead", false}, {"syna", true},
 };
 
+static const char* const kVendorProp = "persist.vendor.sys.fp.vendor";
+
+// Opt-in: only use the stand-in module from fake/, to run without a sensor
+static const char* const kFakeModuleProp = "ro.vendor.sys.fp.fake_module";
+static const fingerprint_hal_t kFakeModule = {"fake", false};
+
+// Opt-in: report UDFPS presses to the UdfpsHandler as soon as the touch controller sees them
+static const char* const kUdfpsFastPathProp = "ro.vendor.sys.fp.udfps_fast_path";
+static const char* const kFodPressStatusNode = "/sys/class/touch/touch_dev/fod_press_status";
+
+// A finger down reported again within this delay, without finger up in between, is a duplicate
+static constexpr auto kFingerDownDedupWindow = std::chrono::milliseconds(1000);
+
 }  // anonymous namespace
 
 namespace android {
@@ -44,53 +61,127 @@ static const uint16_t kVersion = HARDWARE_MODULE_API_VERSION(2, 1);
 
 using RequestStatus = android::hardware::biometrics::fingerprint::V2_1::RequestStatus;
 
+using ::android::base::GetBoolProperty;
+using ::android::base::GetProperty;
 using ::android::base::SetProperty;
 using ::android::base::StartsWith;
+using ::android::base::WriteStringToFd;
 
 BiometricsFingerprint* BiometricsFingerprint::sInstance = nullptr;
 
-BiometricsFingerprint::BiometricsFingerprint()
-    : mClientCallback(nullptr),
-      mDevice(nullptr),
-      mUdfpsHandlerFactory(nullptr),
-      mUdfpsHandler(nullptr) {
-    sInstance = this;  // keep track of the most recent instance
-    for (auto& [class_name, is_udfps] : kModules) {
-        mDevice = openHal(class_name);
+BiometricsFingerprint::BiometricsFingerprint() : BiometricsFingerprint(nullptr, false, nullptr) {
+    // Probing a module that doesn't match the hardware can be slow, try the module that worked
+    // last time first and only scan all of them if it fails
+    const std::string lastVendor = GetProperty(kVendorProp, "");
+    std::vector<const fingerprint_hal_t*> modules;
+    if (GetBoolProperty(kFakeModuleProp, false)) {
+        modules.push_back(&kFakeModule);
+    } else {
+        for (const auto& module : kModules) {
+            if (lastVendor == module.class_name) {
+                modules.insert(modules.begin(), &module);
+            } else {
+                modules.push_back(&module);
+            }
+        }
+    }
+
+    const auto scanStart = std::chrono::steady_clock::now();
+    for (const auto* module : modules) {
+        const auto probeStart = std::chrono::steady_clock::now();
+        mDevice = openHal(module->class_name);
+        const int64_t probeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                        std::chrono::steady_clock::now() - probeStart)
+                                        .count();
         if (!mDevice) {
-            ALOGE("Can't open HAL module, class %s", class_name);
+            ALOGE("Can't open HAL module, class %s, took %" PRId64 "ms", module->class_name,
+                  probeMs);
             continue;
         }
 
-        ALOGI("Opened fingerprint HAL, class %s", class_name);
-        mIsUdfps = is_udfps;
-        SetProperty("persist.vendor.sys.fp.vendor", class_name);
+        ALOGI("Opened fingerprint HAL, class %s, took %" PRId64 "ms%s", module->class_name,
+              probeMs, lastVendor == module->class_name ? " (last known good)" : "");
+        mIsUdfps = module->is_udfps;
+        mModuleClassName = module->class_name;
+        SetProperty(kVendorProp, module->class_name);
         break;
     }
     if (!mDevice) {
         ALOGE("Can't open any HAL module");
-        SetProperty("persist.vendor.sys.fp.vendor", "none");
+        SetProperty(kVendorProp, "none");
     }
+    ALOGI("Fingerprint HAL probing took %" PRId64 "ms",
+          static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                       std::chrono::steady_clock::now() - scanStart)
+                                       .count()));
 
     if (mIsUdfps) {
-        SetProperty("ro.hardware.fp.udfps", "true");
+        initUdfps(getUdfpsHandlerFactory());
+    }
+}
 
-        mUdfpsHandlerFactory = getUdfpsHandlerFactory();
-        if (!mUdfpsHandlerFactory) {
-            ALOGE("Can't get UdfpsHandlerFactory");
-        } else {
-            mUdfpsHandler = mUdfpsHandlerFactory->create();
-            if (!mUdfpsHandler) {
-                ALOGE("Can't create UdfpsHandler");
-            } else {
-                mUdfpsHandler->init(mDevice);
-            }
-        }
+BiometricsFingerprint::BiometricsFingerprint(const hw_module_t* module, bool isUdfps,
+                                             UdfpsHandlerFactory* udfpsHandlerFactory)
+    : mDispatchQueueHead(0),
+      mDispatchQueueCount(0),
+      mDispatchExiting(false),
+      mClientCallback(nullptr),
+      mDevice(nullptr),
+      mIsUdfps(false),
+      mUdfpsHandlerFactory(nullptr),
+      mUdfpsHandler(nullptr),
+      mIsFingerDown(false),
+      mFingerDownHasPosition(false),
+      mDispatchThread(&BiometricsFingerprint::dispatchThreadLoop, this) {
+    sInstance = this;  // keep track of the most recent instance
+
+    if (module == nullptr) {
+        return;
+    }
+
+    mDevice = openHal(module);
+    if (!mDevice) {
+        ALOGE("Can't open HAL module %s", module->name);
+        return;
+    }
+
+    mIsUdfps = isUdfps;
+    mModuleClassName = module->name;
+    if (mIsUdfps) {
+        initUdfps(udfpsHandlerFactory);
+    }
+}
+
+void BiometricsFingerprint::initUdfps(UdfpsHandlerFactory* udfpsHandlerFactory) {
+    SetProperty("ro.hardware.fp.udfps", "true");
+
+    mUdfpsHandlerFactory = udfpsHandlerFactory;
+    if (!mUdfpsHandlerFactory) {
+        ALOGE("Can't get UdfpsHandlerFactory");
+        return;
+    }
+
+    mUdfpsHandler = mUdfpsHandlerFactory->create();
+    if (!mUdfpsHandler) {
+        ALOGE("Can't create UdfpsHandler");
+        return;
+    }
+
+    mUdfpsHandler->init(mDevice);
+
+    if (GetBoolProperty(kUdfpsFastPathProp, false)) {
+        // The press node carries no touch ellipse, minor and major are reported as 0
+        mTouchWatcher = std::make_unique<UdfpsTouchWatcher>(
+                kFodPressStatusNode, [this](uint32_t x, uint32_t y) {
+                    handleFingerDown(x, y, 0, 0, x != 0 || y != 0);
+                });
     }
 }
 
 BiometricsFingerprint::~BiometricsFingerprint() {
     ALOGV("~BiometricsFingerprint()");
+    stopDispatchThread();
+    mTouchWatcher.reset();
     if (mUdfpsHandler) {
         mUdfpsHandlerFactory->destroy(mUdfpsHandler);
     }
@@ -104,6 +195,11 @@ BiometricsFingerprint::~BiometricsFingerprint() {
         return;
     }
     mDevice = nullptr;
+
+    // The module can't call notify() anymore
+    if (sInstance == this) {
+        sInstance = nullptr;
+    }
 }
 
 Return<RequestStatus> BiometricsFingerprint::ErrorFilter(int32_t error) {
@@ -215,6 +311,10 @@ Return<uint64_t> BiometricsFingerprint::preEnroll() {
 Return<RequestStatus> BiometricsFingerprint::enroll(const hidl_array<uint8_t, 69>& hat,
                                                     uint32_t gid, uint32_t timeoutSec) {
     const hw_auth_token_t* authToken = reinterpret_cast<const hw_auth_token_t*>(hat.data());
+    {
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mEnrollStepTime = Clock::now();
+    }
     return ErrorFilter(mDevice->enroll(mDevice, authToken, gid, timeoutSec));
 }
 
@@ -227,7 +327,13 @@ Return<uint64_t> BiometricsFingerprint::getAuthenticatorId() {
 }
 
 Return<RequestStatus> BiometricsFingerprint::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mCancelTime = Clock::now();
+    }
     if (mUdfpsHandler) {
+        std::lock_guard<std::recursive_mutex> lock(mUdfpsHandlerMutex);
+        mIsFingerDown = false;
         mUdfpsHandler->cancel();
     }
     return ErrorFilter(mDevice->cancel(mDevice));
@@ -261,6 +367,11 @@ Return<RequestStatus> BiometricsFingerprint::setActiveGroup(uint32_t gid,
 }
 
 Return<RequestStatus> BiometricsFingerprint::authenticate(uint64_t operationId, uint32_t gid) {
+    {
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mAuthenticateTime = Clock::now();
+        mAcquiredTime.reset();
+    }
     return ErrorFilter(mDevice->authenticate(mDevice, operationId, gid));
 }
 
@@ -270,7 +381,7 @@ Return<bool> BiometricsFingerprint::isUdfps(uint32_t /*sensorId*/) {
 
 Return<void> BiometricsFingerprint::onFingerDown(uint32_t x, uint32_t y, float minor, float major) {
     if (mUdfpsHandler) {
-        mUdfpsHandler->onFingerDown(x, y, minor, major);
+        handleFingerDown(x, y, minor, major, true);
     }
 
     return Void();
@@ -278,12 +389,32 @@ Return<void> BiometricsFingerprint::onFingerDown(uint32_t x, uint32_t y, float m
 
 Return<void> BiometricsFingerprint::onFingerUp() {
     if (mUdfpsHandler) {
+        std::lock_guard<std::recursive_mutex> lock(mUdfpsHandlerMutex);
+        mIsFingerDown = false;
         mUdfpsHandler->onFingerUp();
     }
 
     return Void();
 }
 
+void BiometricsFingerprint::handleFingerDown(uint32_t x, uint32_t y, float minor, float major,
+                                             bool hasPosition) {
+    std::lock_guard<std::recursive_mutex> lock(mUdfpsHandlerMutex);
+    const auto now = std::chrono::steady_clock::now();
+
+    if (mIsFingerDown && now - mFingerDownTime < kFingerDownDedupWindow &&
+        (mFingerDownHasPosition || !hasPosition)) {
+        ALOGD("onFingerDown(%u, %u) already handled", x, y);
+        return;
+    }
+
+    ALOGD("onFingerDown(%u, %u)%s", x, y, hasPosition ? "" : " without position");
+    mIsFingerDown = true;
+    mFingerDownHasPosition = hasPosition;
+    mFingerDownTime = now;
+    mUdfpsHandler->onFingerDown(x, y, minor, major);
+}
+
 IBiometricsFingerprint* BiometricsFingerprint::getInstance() {
     if (!sInstance) {
         sInstance = new BiometricsFingerprint();
@@ -305,6 +436,11 @@ fingerprint_device_t* BiometricsFingerprint::openHal(const char* class_name) {
         return nullptr;
     }
 
+    return openHal(hw_mdl);
+}
+
+fingerprint_device_t* BiometricsFingerprint::openHal(const hw_module_t* hw_mdl) {
+    int err;
     fingerprint_module_t const* module = reinterpret_cast<const fingerprint_module_t*>(hw_mdl);
     if (module->common.methods->open == nullptr) {
         ALOGE("No valid open method");
@@ -337,73 +473,238 @@ fingerprint_device_t* BiometricsFingerprint::openHal(const char* class_name) {
 void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
     BiometricsFingerprint* thisPtr =
             static_cast<BiometricsFingerprint*>(BiometricsFingerprint::getInstance());
-    std::lock_guard<std::mutex> lock(thisPtr->mClientCallbackMutex);
-    if (thisPtr == nullptr || thisPtr->mClientCallback == nullptr) {
+    if (thisPtr == nullptr) {
+        ALOGE("Receiving callbacks without an instance.");
+        return;
+    }
+
+    const Clock::time_point now = Clock::now();
+    thisPtr->recordMessageTiming(*msg, now);
+
+    // The UDFPS handler reacts to the sensor state, keep it in sync with the vendor library
+    if (msg->type == FINGERPRINT_ACQUIRED && thisPtr->mUdfpsHandler) {
+        int32_t vendorCode = 0;
+        FingerprintAcquiredInfo result =
+                VendorAcquiredFilter(msg->data.acquired.acquired_info, &vendorCode);
+        std::lock_guard<std::recursive_mutex> lock(thisPtr->mUdfpsHandlerMutex);
+        thisPtr->mUdfpsHandler->onAcquired(static_cast<int32_t>(result), vendorCode);
+    }
+
+    std::unique_lock<std::mutex> lock(thisPtr->mDispatchMutex);
+    if (thisPtr->mDispatchQueueCount == kDispatchQueueSize) {
+        ALOGW("Client callback queue full, waiting for the client");
+        thisPtr->mDispatchCondition.wait(lock, [thisPtr] {
+            return thisPtr->mDispatchExiting || thisPtr->mDispatchQueueCount < kDispatchQueueSize;
+        });
+    }
+    if (thisPtr->mDispatchExiting) {
+        return;
+    }
+
+    // Copy the whole message, including the auth token, the vendor library owns msg
+    const size_t tail = (thisPtr->mDispatchQueueHead + thisPtr->mDispatchQueueCount) %
+                        kDispatchQueueSize;
+    thisPtr->mDispatchQueue[tail] = {*msg, now};
+    thisPtr->mDispatchQueueCount++;
+
+    lock.unlock();
+    thisPtr->mDispatchCondition.notify_all();
+}
+
+void BiometricsFingerprint::dispatchThreadLoop() {
+    while (true) {
+        QueuedMessage message;
+        {
+            std::unique_lock<std::mutex> lock(mDispatchMutex);
+            mDispatchCondition.wait(
+                    lock, [this] { return mDispatchExiting || mDispatchQueueCount > 0; });
+            if (mDispatchQueueCount == 0) {
+                return;
+            }
+
+            message = mDispatchQueue[mDispatchQueueHead];
+            mDispatchQueueHead = (mDispatchQueueHead + 1) % kDispatchQueueSize;
+            mDispatchQueueCount--;
+        }
+        // Wake up notify() if it waits for room in the queue
+        mDispatchCondition.notify_all();
+
+        const Clock::time_point start = Clock::now();
+        dispatch(message.msg);
+        const Clock::time_point end = Clock::now();
+
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mCallbackQueueDelay.record(start - message.queueTime);
+        mCallbackDuration.record(end - start);
+    }
+}
+
+void BiometricsFingerprint::recordMessageTiming(const fingerprint_msg_t& msg,
+                                                Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mStatsMutex);
+
+    switch (msg.type) {
+        case FINGERPRINT_ACQUIRED:
+            if (mAuthenticateTime) {
+                mAuthenticateToAcquired.record(now - *mAuthenticateTime);
+                mAuthenticateTime.reset();
+            }
+            mAcquiredTime = now;
+            break;
+        case FINGERPRINT_AUTHENTICATED:
+            if (mAcquiredTime) {
+                mAcquiredToAuthenticated.record(now - *mAcquiredTime);
+                mAcquiredTime.reset();
+            }
+            break;
+        case FINGERPRINT_TEMPLATE_ENROLLING:
+            if (mEnrollStepTime) {
+                mEnrollStep.record(now - *mEnrollStepTime);
+            }
+            if (msg.data.enroll.samples_remaining > 0) {
+                mEnrollStepTime = now;
+            } else {
+                mEnrollStepTime.reset();
+            }
+            break;
+        case FINGERPRINT_ERROR:
+            if (msg.data.error == FINGERPRINT_ERROR_CANCELED && mCancelTime) {
+                mCancelLatency.record(now - *mCancelTime);
+            }
+            // Any error ends the current operation
+            mAuthenticateTime.reset();
+            mAcquiredTime.reset();
+            mEnrollStepTime.reset();
+            mCancelTime.reset();
+            break;
+        default:
+            break;
+    }
+}
+
+Return<void> BiometricsFingerprint::debug(const hidl_handle& fd,
+                                          const hidl_vec<hidl_string>& args) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        ALOGE("%s: missing fd for writing", __FUNCTION__);
+        return Void();
+    }
+
+    std::ostringstream stream;
+    bool reset = false;
+    for (const auto& arg : args) {
+        if (std::string(arg) == "--reset") {
+            reset = true;
+        } else {
+            stream << "Unknown argument: " << std::string(arg) << std::endl;
+        }
+    }
+
+    stream << "Module: " << (mDevice ? mModuleClassName : "none") << std::endl;
+    stream << "UDFPS: " << (mIsUdfps ? "true" : "false") << std::endl;
+    stream << "UDFPS touch fast path: " << (mTouchWatcher ? "true" : "false") << std::endl;
+
+    std::lock_guard<std::mutex> lock(mStatsMutex);
+    const std::pair<const char*, LatencyHistogram*> histograms[] = {
+            {"Authenticate to first acquired", &mAuthenticateToAcquired},
+            {"Acquired to authenticated", &mAcquiredToAuthenticated},
+            {"Enroll step", &mEnrollStep},
+            {"Cancel to canceled", &mCancelLatency},
+            {"Callback queue delay", &mCallbackQueueDelay},
+            {"Callback duration", &mCallbackDuration},
+    };
+    for (const auto& [name, histogram] : histograms) {
+        stream << name << ": ";
+        histogram->dump(stream);
+        stream << std::endl;
+
+        if (reset) {
+            histogram->reset();
+        }
+    }
+    if (reset) {
+        stream << "Statistics reset" << std::endl;
+    }
+
+    WriteStringToFd(stream.str(), fd->data[0]);
+    return Void();
+}
+
+void BiometricsFingerprint::stopDispatchThread() {
+    {
+        std::lock_guard<std::mutex> lock(mDispatchMutex);
+        mDispatchExiting = true;
+    }
+    mDispatchCondition.notify_all();
+    if (mDispatchThread.joinable()) {
+        mDispatchThread.join();
+    }
+}
+
+void BiometricsFingerprint::dispatch(const fingerprint_msg_t& msg) {
+    std::lock_guard<std::mutex> lock(mClientCallbackMutex);
+    if (mClientCallback == nullptr) {
         ALOGE("Receiving callbacks before the client callback is registered.");
         return;
     }
-    const uint64_t devId = reinterpret_cast<uint64_t>(thisPtr->mDevice);
-    switch (msg->type) {
+    const uint64_t devId = reinterpret_cast<uint64_t>(mDevice);
+    switch (msg.type) {
         case FINGERPRINT_ERROR: {
             int32_t vendorCode = 0;
-            FingerprintError result = VendorErrorFilter(msg->data.error, &vendorCode);
+            FingerprintError result = VendorErrorFilter(msg.data.error, &vendorCode);
             ALOGD("onError(%d)", result);
-            if (!thisPtr->mClientCallback->onError(devId, result, vendorCode).isOk()) {
+            if (!mClientCallback->onError(devId, result, vendorCode).isOk()) {
                 ALOGE("failed to invoke fingerprint onError callback");
             }
         } break;
         case FINGERPRINT_ACQUIRED: {
             int32_t vendorCode = 0;
             FingerprintAcquiredInfo result =
-                    VendorAcquiredFilter(msg->data.acquired.acquired_info, &vendorCode);
+                    VendorAcquiredFilter(msg.data.acquired.acquired_info, &vendorCode);
             ALOGD("onAcquired(%d)", result);
-            if (thisPtr->mUdfpsHandler) {
-                thisPtr->mUdfpsHandler->onAcquired(static_cast<int32_t>(result), vendorCode);
-            }
-            if (!thisPtr->mClientCallback->onAcquired(devId, result, vendorCode).isOk()) {
+            if (!mClientCallback->onAcquired(devId, result, vendorCode).isOk()) {
                 ALOGE("failed to invoke fingerprint onAcquired callback");
             }
         } break;
         case FINGERPRINT_TEMPLATE_ENROLLING:
-            ALOGD("onEnrollResult(fid=%d, gid=%d, rem=%d)", msg->data.enroll.finger.fid,
-                  msg->data.enroll.finger.gid, msg->data.enroll.samples_remaining);
-            if (!thisPtr->mClientCallback
-                         ->onEnrollResult(devId, msg->data.enroll.finger.fid,
-                                          msg->data.enroll.finger.gid,
-                                          msg->data.enroll.samples_remaining)
+            ALOGD("onEnrollResult(fid=%d, gid=%d, rem=%d)", msg.data.enroll.finger.fid,
+                  msg.data.enroll.finger.gid, msg.data.enroll.samples_remaining);
+            if (!mClientCallback
+                         ->onEnrollResult(devId, msg.data.enroll.finger.fid,
+                                          msg.data.enroll.finger.gid,
+                                          msg.data.enroll.samples_remaining)
                          .isOk()) {
                 ALOGE("failed to invoke fingerprint onEnrollResult callback");
             }
             break;
         case FINGERPRINT_TEMPLATE_REMOVED:
-            ALOGD("onRemove(fid=%d, gid=%d, rem=%d)", msg->data.removed.finger.fid,
-                  msg->data.removed.finger.gid, msg->data.removed.remaining_templates);
-            if (!thisPtr->mClientCallback
-                         ->onRemoved(devId, msg->data.removed.finger.fid,
-                                     msg->data.removed.finger.gid,
-                                     msg->data.removed.remaining_templates)
+            ALOGD("onRemove(fid=%d, gid=%d, rem=%d)", msg.data.removed.finger.fid,
+                  msg.data.removed.finger.gid, msg.data.removed.remaining_templates);
+            if (!mClientCallback
+                         ->onRemoved(devId, msg.data.removed.finger.fid,
+                                     msg.data.removed.finger.gid,
+                                     msg.data.removed.remaining_templates)
                          .isOk()) {
                 ALOGE("failed to invoke fingerprint onRemoved callback");
             }
             break;
         case FINGERPRINT_AUTHENTICATED:
-            if (msg->data.authenticated.finger.fid != 0) {
-                ALOGD("onAuthenticated(fid=%d, gid=%d)", msg->data.authenticated.finger.fid,
-                      msg->data.authenticated.finger.gid);
-                const uint8_t* hat = reinterpret_cast<const uint8_t*>(&msg->data.authenticated.hat);
+            if (msg.data.authenticated.finger.fid != 0) {
+                ALOGD("onAuthenticated(fid=%d, gid=%d)", msg.data.authenticated.finger.fid,
+                      msg.data.authenticated.finger.gid);
+                const uint8_t* hat = reinterpret_cast<const uint8_t*>(&msg.data.authenticated.hat);
                 const hidl_vec<uint8_t> token(
-                        std::vector<uint8_t>(hat, hat + sizeof(msg->data.authenticated.hat)));
-                if (!thisPtr->mClientCallback
-                             ->onAuthenticated(devId, msg->data.authenticated.finger.fid,
-                                               msg->data.authenticated.finger.gid, token)
+                        std::vector<uint8_t>(hat, hat + sizeof(msg.data.authenticated.hat)));
+                if (!mClientCallback
+                             ->onAuthenticated(devId, msg.data.authenticated.finger.fid,
+                                               msg.data.authenticated.finger.gid, token)
                              .isOk()) {
                     ALOGE("failed to invoke fingerprint onAuthenticated callback");
                 }
             } else {
                 // Not a recognized fingerprint
-                if (!thisPtr->mClientCallback
-                             ->onAuthenticated(devId, msg->data.authenticated.finger.fid,
-                                               msg->data.authenticated.finger.gid,
+                if (!mClientCallback
+                             ->onAuthenticated(devId, msg.data.authenticated.finger.fid,
+                                               msg.data.authenticated.finger.gid,
                                                hidl_vec<uint8_t>())
                              .isOk()) {
                     ALOGE("failed to invoke fingerprint onAuthenticated callback");
@@ -411,12 +712,12 @@ void BiometricsFingerprint::notify(const fingerprint_msg_t* msg) {
             }
             break;
         case FINGERPRINT_TEMPLATE_ENUMERATING:
-            ALOGD("onEnumerate(fid=%d, gid=%d, rem=%d)", msg->data.enumerated.finger.fid,
-                  msg->data.enumerated.finger.gid, msg->data.enumerated.remaining_templates);
-            if (!thisPtr->mClientCallback
-                         ->onEnumerate(devId, msg->data.enumerated.finger.fid,
-                                       msg->data.enumerated.finger.gid,
-                                       msg->data.enumerated.remaining_templates)
+            ALOGD("onEnumerate(fid=%d, gid=%d, rem=%d)", msg.data.enumerated.finger.fid,
+                  msg.data.enumerated.finger.gid, msg.data.enumerated.remaining_templates);
+            if (!mClientCallback
+                         ->onEnumerate(devId, msg.data.enumerated.finger.fid,
+                                       msg.data.enumerated.finger.gid,
+                                       msg.data.enumerated.remaining_templates)
                          .isOk()) {
                 ALOGE("failed to invoke fingerprint onEnumerate callback");
             }
@@ -13,7 +13,17 @@
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 #include <log/log.h>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include "LatencyHistogram.h"
 #include "UdfpsHandler.h"
+#include "UdfpsTouchWatcher.h"
 #include "fingerprint.h"
 
 namespace android {
@@ -24,6 +34,7 @@ namespace V2_3 {
 namespace implementation {
 
 using ::android::sp;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
@@ -33,10 +44,23 @@ using ::android::hardware::biometrics::fingerprint::V2_1::FingerprintError;
 using ::android::hardware::biometrics::fingerprint::V2_1::IBiometricsFingerprintClientCallback;
 using ::android::hardware::biometrics::fingerprint::V2_1::RequestStatus;
 using ::android::hardware::biometrics::fingerprint::V2_3::IBiometricsFingerprint;
+using ::android::hardware::stats::LatencyHistogram;
 
 struct BiometricsFingerprint : public IBiometricsFingerprint {
   public:
     BiometricsFingerprint();
+
+    /**
+     * Constructor, using the given module instead of probing the known ones, e.g. the stand-in
+     * module from fake/ linked in directly.
+     *
+     * @param module The fingerprint module to open
+     * @param isUdfps Whether the module drives an under display sensor
+     * @param udfpsHandlerFactory Creates the UdfpsHandler of an under display sensor, may be null
+     */
+    BiometricsFingerprint(const hw_module_t* module, bool isUdfps,
+                          UdfpsHandlerFactory* udfpsHandlerFactory);
+
     ~BiometricsFingerprint();
 
     // Method to wrap legacy HAL with BiometricsFingerprint class
@@ -63,8 +87,16 @@ struct BiometricsFingerprint : public IBiometricsFingerprint {
     Return<void> onFingerDown(uint32_t x, uint32_t y, float minor, float major) override;
     Return<void> onFingerUp() override;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    // Dumps operation timing statistics, "--reset" resets them afterwards.
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& args) override;
+
   private:
+    using Clock = std::chrono::steady_clock;
+
     static fingerprint_device_t* openHal(const char* class_name);
+    static fingerprint_device_t* openHal(const hw_module_t* module);
+    void initUdfps(UdfpsHandlerFactory* udfpsHandlerFactory);
     static void notify(
             const fingerprint_msg_t* msg); /* Static callback for legacy HAL implementation */
     static Return<RequestStatus> ErrorFilter(int32_t error);
@@ -72,12 +104,59 @@ struct BiometricsFingerprint : public IBiometricsFingerprint {
     static FingerprintAcquiredInfo VendorAcquiredFilter(int32_t error, int32_t* vendorCode);
     static BiometricsFingerprint* sInstance;
 
+    // Client callbacks are delivered from a dedicated thread, in order, so that a slow client
+    // never stalls the vendor library thread calling notify()
+    void dispatchThreadLoop();
+    void dispatch(const fingerprint_msg_t& msg);
+    void stopDispatchThread();
+
+    struct QueuedMessage {
+        fingerprint_msg_t msg;
+        Clock::time_point queueTime;
+    };
+
+    static constexpr size_t kDispatchQueueSize = 64;
+    std::mutex mDispatchMutex;
+    std::condition_variable mDispatchCondition;
+    std::array<QueuedMessage, kDispatchQueueSize> mDispatchQueue;
+    size_t mDispatchQueueHead;
+    size_t mDispatchQueueCount;
+    bool mDispatchExiting;
+
     std::mutex mClientCallbackMutex;
     sp<IBiometricsFingerprintClientCallback> mClientCallback;
     fingerprint_device_t* mDevice;
     bool mIsUdfps;
     UdfpsHandlerFactory* mUdfpsHandlerFactory;
     UdfpsHandler* mUdfpsHandler;
+
+    // Finger down reported by both the touch watcher and the framework is only handled once, unless
+    // only the framework knows where the finger is. All UdfpsHandler calls are serialized, so that
+    // a finger down handled late can't undo a finger up.
+    void handleFingerDown(uint32_t x, uint32_t y, float minor, float major, bool hasPosition);
+    // Recursive, the vendor library may notify from within a handler call
+    std::recursive_mutex mUdfpsHandlerMutex;
+    bool mIsFingerDown;
+    bool mFingerDownHasPosition;
+    std::chrono::steady_clock::time_point mFingerDownTime;
+    std::unique_ptr<UdfpsTouchWatcher> mTouchWatcher;
+
+    // Operation timing statistics
+    void recordMessageTiming(const fingerprint_msg_t& msg, Clock::time_point now);
+    std::string mModuleClassName;
+    std::mutex mStatsMutex;
+    std::optional<Clock::time_point> mAuthenticateTime;
+    std::optional<Clock::time_point> mAcquiredTime;
+    std::optional<Clock::time_point> mEnrollStepTime;
+    std::optional<Clock::time_point> mCancelTime;
+    LatencyHistogram mAuthenticateToAcquired;
+    LatencyHistogram mAcquiredToAuthenticated;
+    LatencyHistogram mEnrollStep;
+    LatencyHistogram mCancelLatency;
+    LatencyHistogram mCallbackQueueDelay;
+    LatencyHistogram mCallbackDuration;
+
+    std::thread mDispatchThread;
 };
 
 }  // namespace implementation
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "android.hardware.biometrics.fingerprint@2.3-service.xiaomi"
+
+#include "UdfpsTouchWatcher.h"
+
+#include <fcntl.h>
+#include <log/log.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace V2_3 {
+namespace implementation {
+
+UdfpsTouchWatcher::UdfpsTouchWatcher(const std::string& pressNode, Callback onPress)
+    : mPressNode(pressNode),
+      mOnPress(onPress),
+      mPressFd(open(pressNode.c_str(), O_RDONLY | O_CLOEXEC)),
+      mEventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+    if (mPressFd < 0 || mEventFd < 0) {
+        ALOGE("Can't watch %s, error: %d", mPressNode.c_str(), errno);
+        return;
+    }
+
+    // sysfs only notifies pollers once the node has been read
+    uint32_t x, y;
+    readPress(&x, &y);
+
+    mThread = std::thread(&UdfpsTouchWatcher::threadLoop, this);
+}
+
+UdfpsTouchWatcher::~UdfpsTouchWatcher() {
+    if (mThread.joinable()) {
+        eventfd_write(mEventFd, 1);
+        mThread.join();
+    }
+}
+
+void UdfpsTouchWatcher::threadLoop() {
+    struct pollfd fds[] = {
+            {.fd = mEventFd, .events = POLLIN},
+            {.fd = mPressFd, .events = POLLERR | POLLPRI},
+    };
+
+    while (true) {
+        int rc = TEMP_FAILURE_RETRY(poll(fds, 2, -1));
+        if (rc < 0) {
+            ALOGE("Failed to poll %s, error: %d", mPressNode.c_str(), errno);
+            return;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            return;
+        }
+
+        uint32_t x, y;
+        if ((fds[1].revents & (POLLERR | POLLPRI)) && readPress(&x, &y)) {
+            mOnPress(x, y);
+        }
+    }
+}
+
+// Same format as parsed by the UDFPS sensor: "x,y,state", or only "state" on some touch drivers
+bool UdfpsTouchWatcher::readPress(uint32_t* x, uint32_t* y) {
+    char buffer[64];
+
+    ssize_t rc = TEMP_FAILURE_RETRY(pread(mPressFd, buffer, sizeof(buffer) - 1, 0));
+    if (rc < 0) {
+        ALOGE("Failed to read %s, error: %d", mPressNode.c_str(), errno);
+        return false;
+    }
+    buffer[rc] = '\0';
+
+    int state = 0;
+    rc = sscanf(buffer, "%u,%u,%d", x, y, &state);
+    if (rc == 1) {
+        // Only the state is reported
+        state = *x;
+        *x = 0;
+        *y = 0;
+    } else if (rc < 3) {
+        ALOGE("Failed to parse %s: %s", mPressNode.c_str(), buffer);
+        return false;
+    }
+
+    return state > 0;
+}
+
+}  // namespace implementation
+}  // namespace V2_3
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace android {
+namespace hardware {
+namespace biometrics {
+namespace fingerprint {
+namespace V2_3 {
+namespace implementation {
+
+/*
+ * Watches the touch controller fingerprint press node, the one backing the UDFPS sensor of the
+ * sensors HAL, and reports presses directly, without going through the framework.
+ */
+class UdfpsTouchWatcher {
+  public:
+    // Presses reporting only their state have x and y set to 0
+    using Callback = std::function<void(uint32_t x, uint32_t y)>;
+
+    UdfpsTouchWatcher(const std::string& pressNode, Callback onPress);
+    ~UdfpsTouchWatcher();
+
+  private:
+    void threadLoop();
+    bool readPress(uint32_t* x, uint32_t* y);
+
+    const std::string mPressNode;
+    const Callback mOnPress;
+
+    ::android::base::unique_fd mPressFd;
+    ::android::base::unique_fd mEventFd;
+
+    std::thread mThread;
+};
+
+}  // namespace implementation
+}  // namespace V2_3
+}  // namespace fingerprint
+}  // namespace biometrics
+}  // namespace hardware
+}  // namespace android
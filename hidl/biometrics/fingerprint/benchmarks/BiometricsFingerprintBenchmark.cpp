@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <android-base/properties.h>
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include "BiometricsFingerprint.h"
+#include "UdfpsHandler.h"
+#include "fingerprint.h"
+
+using ::android::sp;
+using ::android::base::SetProperty;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::android::hardware::biometrics::fingerprint::V2_1::FingerprintAcquiredInfo;
+using ::android::hardware::biometrics::fingerprint::V2_1::FingerprintError;
+using ::android::hardware::biometrics::fingerprint::V2_1::IBiometricsFingerprintClientCallback;
+using ::android::hardware::biometrics::fingerprint::V2_3::implementation::BiometricsFingerprint;
+
+// The stand-in module from fake/, linked in
+extern fingerprint_module_t HAL_MODULE_INFO_SYM;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kBurstSize = 256;
+
+/*
+ * Counts the callbacks and how long they took to arrive since the module called notify().
+ */
+class FakeClientCallback : public IBiometricsFingerprintClientCallback {
+  public:
+    Return<void> onEnrollResult(uint64_t, uint32_t, uint32_t, uint32_t) override {
+        return received();
+    }
+    Return<void> onAcquired(uint64_t, FingerprintAcquiredInfo, int32_t) override {
+        return received();
+    }
+    Return<void> onAuthenticated(uint64_t, uint32_t, uint32_t, const hidl_vec<uint8_t>&) override {
+        return received();
+    }
+    Return<void> onError(uint64_t, FingerprintError, int32_t) override { return received(); }
+    Return<void> onRemoved(uint64_t, uint32_t, uint32_t, uint32_t) override { return received(); }
+    Return<void> onEnumerate(uint64_t, uint32_t, uint32_t, uint32_t) override {
+        return received();
+    }
+
+    void waitFor(uint64_t count) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this, count] { return mCount >= count; });
+    }
+
+    uint64_t getCount() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mCount;
+    }
+
+    Clock::duration getTotalLatency() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mTotalLatency;
+    }
+
+    // Called by the module thread before handing a message to the HAL
+    static void notify(const fingerprint_msg_t* msg) {
+        {
+            std::lock_guard<std::mutex> lock(sNotifyMutex);
+            sNotifyTimes.push_back(Clock::now());
+        }
+        sHalNotify(msg);
+    }
+
+    static fingerprint_notify_t sHalNotify;
+
+  private:
+    Return<void> received() {
+        const Clock::time_point now = Clock::now();
+        Clock::time_point notifyTime;
+        {
+            // Callbacks are delivered in order
+            std::lock_guard<std::mutex> lock(sNotifyMutex);
+            notifyTime = sNotifyTimes.front();
+            sNotifyTimes.pop_front();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTotalLatency += now - notifyTime;
+            mCount++;
+        }
+        mCondition.notify_all();
+        return Void();
+    }
+
+    static std::mutex sNotifyMutex;
+    static std::deque<Clock::time_point> sNotifyTimes;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    uint64_t mCount = 0;
+    Clock::duration mTotalLatency{0};
+};
+
+fingerprint_notify_t FakeClientCallback::sHalNotify = nullptr;
+std::mutex FakeClientCallback::sNotifyMutex;
+std::deque<Clock::time_point> FakeClientCallback::sNotifyTimes;
+
+/*
+ * A UdfpsHandler doing nothing, so that only the cost of the hooks themselves is measured.
+ */
+class FakeUdfpsHandler : public UdfpsHandler {
+  public:
+    void init(fingerprint_device_t*) override {}
+    void onFingerDown(uint32_t, uint32_t, float, float) override { sFingerDownCount++; }
+    void onFingerUp() override {}
+    void onAcquired(int32_t, int32_t) override { sAcquiredCount++; }
+    void cancel() override {}
+
+    static std::atomic<uint64_t> sFingerDownCount;
+    static std::atomic<uint64_t> sAcquiredCount;
+};
+
+std::atomic<uint64_t> FakeUdfpsHandler::sFingerDownCount;
+std::atomic<uint64_t> FakeUdfpsHandler::sAcquiredCount;
+
+UdfpsHandlerFactory kFakeUdfpsHandlerFactory = {
+        .create = []() -> UdfpsHandler* { return new FakeUdfpsHandler(); },
+        .destroy = [](UdfpsHandler* handler) { delete handler; },
+};
+
+/*
+ * The HAL on top of the stand-in module, with notify() timed by the client callback.
+ */
+struct Fixture {
+    Fixture(bool isUdfps)
+        : hal(new BiometricsFingerprint(&HAL_MODULE_INFO_SYM.common, isUdfps,
+                                        &kFakeUdfpsHandlerFactory)),
+          callback(new FakeClientCallback()) {
+        auto* device = reinterpret_cast<fingerprint_device_t*>(
+                static_cast<uint64_t>(hal->setNotify(callback)));
+        FakeClientCallback::sHalNotify = device->notify;
+        device->set_notify(device, FakeClientCallback::notify);
+    }
+
+    sp<BiometricsFingerprint> hal;
+    sp<FakeClientCallback> callback;
+};
+
+void setScript(const std::string& script, uint32_t repeat) {
+    SetProperty("vendor.fingerprint.fake.authenticate", script);
+    SetProperty("vendor.fingerprint.fake.repeat", std::to_string(repeat));
+}
+
+/*
+ * A successful authentication, acquired then authenticated without delay, for a regular (0) or
+ * an under display (1) sensor. Reports the time from notify() to the client callback.
+ */
+void BM_BiometricsFingerprint_Authenticate(benchmark::State& state) {
+    setScript("0:acquired:0,0:authenticated:1", 1);
+    Fixture fixture(state.range(0));
+
+    uint64_t expected = 0;
+    for (auto _ : state) {
+        fixture.hal->authenticate(1, 0);
+        expected += 2;
+        fixture.callback->waitFor(expected);
+    }
+
+    state.SetItemsProcessed(expected);
+    state.counters["notify_to_callback_us"] =
+            std::chrono::duration<double, std::micro>(fixture.callback->getTotalLatency())
+                    .count() /
+            expected;
+}
+BENCHMARK(BM_BiometricsFingerprint_Authenticate)->ArgName("udfps")->Arg(0)->Arg(1)->UseRealTime();
+
+/*
+ * Bursts of acquired messages emitted back to back by the module, i.e. the throughput of the
+ * notify() to dispatch thread hand off, with and without the UdfpsHandler onAcquired() hook.
+ */
+void BM_BiometricsFingerprint_AcquiredBurst(benchmark::State& state) {
+    setScript("0:acquired:0", kBurstSize);
+    Fixture fixture(state.range(0));
+    const uint64_t startAcquired = FakeUdfpsHandler::sAcquiredCount;
+
+    uint64_t expected = 0;
+    for (auto _ : state) {
+        fixture.hal->authenticate(1, 0);
+        expected += kBurstSize;
+        fixture.callback->waitFor(expected);
+    }
+
+    state.SetItemsProcessed(expected);
+    state.counters["notify_to_callback_us"] =
+            std::chrono::duration<double, std::micro>(fixture.callback->getTotalLatency())
+                    .count() /
+            expected;
+    state.counters["udfps_hooks"] = FakeUdfpsHandler::sAcquiredCount - startAcquired;
+}
+BENCHMARK(BM_BiometricsFingerprint_AcquiredBurst)
+        ->ArgName("udfps")
+        ->Arg(0)
+        ->Arg(1)
+        ->UseRealTime();
+
+/*
+ * A UDFPS press and release through the framework entry points, i.e. the cost of the
+ * UdfpsHandler hooks including the finger down de-duplication.
+ */
+void BM_BiometricsFingerprint_FingerDownUp(benchmark::State& state) {
+    Fixture fixture(true);
+    const uint64_t startFingerDown = FakeUdfpsHandler::sFingerDownCount;
+
+    for (auto _ : state) {
+        fixture.hal->onFingerDown(540, 1800, 8.0f, 10.0f);
+        fixture.hal->onFingerUp();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["handled"] = FakeUdfpsHandler::sFingerDownCount - startFingerDown;
+}
+BENCHMARK(BM_BiometricsFingerprint_FingerDownUp);
+
+/*
+ * Finger down reported twice per press, as with the touch fast path, the second one being
+ * dropped.
+ */
+void BM_BiometricsFingerprint_DuplicateFingerDown(benchmark::State& state) {
+    Fixture fixture(true);
+    const uint64_t startFingerDown = FakeUdfpsHandler::sFingerDownCount;
+
+    for (auto _ : state) {
+        fixture.hal->onFingerDown(540, 1800, 0.0f, 0.0f);
+        fixture.hal->onFingerDown(540, 1800, 8.0f, 10.0f);
+        fixture.hal->onFingerUp();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["handled"] = FakeUdfpsHandler::sFingerDownCount - startFingerDown;
+}
+BENCHMARK(BM_BiometricsFingerprint_DuplicateFingerDown);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Stand-in fingerprint module, for running the fingerprint HAL service without a sensor.
+ *
+ * Each authenticate and enroll call replays a script read from a property:
+ *   vendor.fingerprint.fake.authenticate
+ *   vendor.fingerprint.fake.enroll
+ *
+ * A script is a comma separated list of <delay ms>:<type>:<argument> steps, where type is one of
+ *   acquired       argument is the acquired info
+ *   enrolling      argument is the number of samples remaining
+ *   authenticated  argument is the finger id, 0 for no match
+ *   error          argument is the error code
+ * Delays are relative to the previous step, so a script emits messages at a fixed rate no matter
+ * how long the service takes to handle them. vendor.fingerprint.fake.repeat replays the script
+ * that many times in a row, to generate sustained load.
+ */
+
+#define LOG_TAG "fingerprint.fake"
+
+#include <android-base/parseint.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+#include <errno.h>
+#include <hardware/hardware.h>
+#include <hardware/hw_auth_token.h>
+#include <log/log.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fingerprint.h"
+
+using ::android::base::GetProperty;
+using ::android::base::GetUintProperty;
+using ::android::base::ParseUint;
+using ::android::base::Split;
+
+using Clock = std::chrono::steady_clock;
+
+static const char* const kAuthenticateScriptProp = "vendor.fingerprint.fake.authenticate";
+static const char* const kEnrollScriptProp = "vendor.fingerprint.fake.enroll";
+static const char* const kRepeatProp = "vendor.fingerprint.fake.repeat";
+
+static const char* const kDefaultAuthenticateScript = "50:acquired:0,30:authenticated:1";
+static const char* const kDefaultEnrollScript =
+        "500:acquired:0,0:enrolling:2,500:acquired:0,0:enrolling:1,500:acquired:0,0:enrolling:0";
+
+static const uint64_t kAuthenticatorId = 1;
+
+struct fake_step_t {
+    std::chrono::milliseconds delay;
+    fingerprint_msg_t msg;
+};
+
+struct fake_context_t {
+    fingerprint_device_t device;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<fake_step_t> steps;
+    Clock::time_point next_step_time;
+    bool exiting;
+
+    uint32_t gid;
+    uint64_t challenge;
+    std::set<uint32_t> fids;
+
+    std::thread thread;
+};
+
+static fake_context_t* fake_context(struct fingerprint_device* dev) {
+    return reinterpret_cast<fake_context_t*>(dev);
+}
+
+static fake_step_t fake_make_step(fingerprint_msg_type_t type) {
+    fake_step_t step;
+
+    step.delay = std::chrono::milliseconds::zero();
+    memset(&step.msg, 0, sizeof(step.msg));
+    step.msg.type = type;
+
+    return step;
+}
+
+static bool fake_parse_script(const std::string& script, uint32_t gid, uint32_t enroll_fid,
+                              uint64_t operation_id, std::vector<fake_step_t>& steps) {
+    for (const auto& entry : Split(script, ",")) {
+        const std::vector<std::string> fields = Split(entry, ":");
+        uint32_t delay, arg;
+
+        if (fields.size() != 3 || !ParseUint(fields[0], &delay) || !ParseUint(fields[2], &arg)) {
+            ALOGE("Invalid script step: %s", entry.c_str());
+            return false;
+        }
+
+        fake_step_t step;
+        if (fields[1] == "acquired") {
+            step = fake_make_step(FINGERPRINT_ACQUIRED);
+            step.msg.data.acquired.acquired_info = static_cast<fingerprint_acquired_info_t>(arg);
+        } else if (fields[1] == "enrolling") {
+            step = fake_make_step(FINGERPRINT_TEMPLATE_ENROLLING);
+            step.msg.data.enroll.finger = {.gid = gid, .fid = enroll_fid};
+            step.msg.data.enroll.samples_remaining = arg;
+        } else if (fields[1] == "authenticated") {
+            step = fake_make_step(FINGERPRINT_AUTHENTICATED);
+            step.msg.data.authenticated.finger = {.gid = gid, .fid = arg};
+            if (arg != 0) {
+                hw_auth_token_t& hat = step.msg.data.authenticated.hat;
+                hat.version = HW_AUTH_TOKEN_VERSION;
+                hat.challenge = operation_id;
+                hat.authenticator_id = kAuthenticatorId;
+            }
+        } else if (fields[1] == "error") {
+            step = fake_make_step(FINGERPRINT_ERROR);
+            step.msg.data.error = static_cast<fingerprint_error_t>(arg);
+        } else {
+            ALOGE("Invalid script step type: %s", fields[1].c_str());
+            return false;
+        }
+        step.delay = std::chrono::milliseconds(delay);
+
+        steps.push_back(step);
+    }
+
+    return true;
+}
+
+/* Replaces whatever is running, the HAL only has a single operation in flight */
+static void fake_run_locked(fake_context_t* ctx, const std::vector<fake_step_t>& steps,
+                            uint32_t repeat = 1) {
+    ctx->steps.clear();
+    for (uint32_t i = 0; i < repeat; i++) {
+        ctx->steps.insert(ctx->steps.end(), steps.begin(), steps.end());
+    }
+
+    if (!ctx->steps.empty()) {
+        ctx->next_step_time = Clock::now() + ctx->steps.front().delay;
+    }
+    ctx->condition.notify_one();
+}
+
+static int fake_run_script(fake_context_t* ctx, const char* prop, const char* default_script,
+                           uint32_t enroll_fid, uint64_t operation_id) {
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    std::vector<fake_step_t> steps;
+
+    if (!fake_parse_script(GetProperty(prop, default_script), ctx->gid, enroll_fid, operation_id,
+                           steps)) {
+        return -EINVAL;
+    }
+
+    fake_run_locked(ctx, steps, std::max<uint32_t>(1, GetUintProperty<uint32_t>(kRepeatProp, 1)));
+
+    return 0;
+}
+
+static void fake_thread_loop(fake_context_t* ctx) {
+    std::unique_lock<std::mutex> lock(ctx->mutex);
+
+    while (!ctx->exiting) {
+        if (ctx->steps.empty()) {
+            ctx->condition.wait(lock);
+            continue;
+        }
+        if (Clock::now() < ctx->next_step_time) {
+            ctx->condition.wait_until(lock, ctx->next_step_time);
+            continue;
+        }
+
+        const fingerprint_msg_t msg = ctx->steps.front().msg;
+        ctx->steps.pop_front();
+        if (!ctx->steps.empty()) {
+            // Keep the pace of the script even if notify() was slow
+            ctx->next_step_time += ctx->steps.front().delay;
+        }
+
+        if (msg.type == FINGERPRINT_TEMPLATE_ENROLLING && msg.data.enroll.samples_remaining == 0) {
+            ctx->fids.insert(msg.data.enroll.finger.fid);
+        }
+
+        const fingerprint_notify_t notify = ctx->device.notify;
+        lock.unlock();
+        if (notify) {
+            notify(&msg);
+        }
+        lock.lock();
+    }
+}
+
+static int fake_set_notify(struct fingerprint_device* dev, fingerprint_notify_t notify) {
+    fake_context_t* ctx = fake_context(dev);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    ctx->device.notify = notify;
+
+    return 0;
+}
+
+static uint64_t fake_pre_enroll(struct fingerprint_device* dev) {
+    fake_context_t* ctx = fake_context(dev);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    ctx->challenge = Clock::now().time_since_epoch().count();
+
+    return ctx->challenge;
+}
+
+static int fake_enroll(struct fingerprint_device* dev, const hw_auth_token_t* hat,
+                       uint32_t /* gid */, uint32_t /* timeout_sec */) {
+    fake_context_t* ctx = fake_context(dev);
+    uint32_t fid;
+
+    {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        if (hat == nullptr || hat->challenge != ctx->challenge) {
+            ALOGE("Invalid enroll challenge");
+            return -EPERM;
+        }
+        fid = ctx->fids.empty() ? 1 : *ctx->fids.rbegin() + 1;
+    }
+
+    return fake_run_script(ctx, kEnrollScriptProp, kDefaultEnrollScript, fid, 0);
+}
+
+static int fake_post_enroll(struct fingerprint_device* dev) {
+    fake_context_t* ctx = fake_context(dev);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    ctx->challenge = 0;
+
+    return 0;
+}
+
+static uint64_t fake_get_authenticator_id(struct fingerprint_device* /* dev */) {
+    return kAuthenticatorId;
+}
+
+static int fake_cancel(struct fingerprint_device* dev) {
+    fake_context_t* ctx = fake_context(dev);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    fake_step_t step = fake_make_step(FINGERPRINT_ERROR);
+    step.msg.data.error = FINGERPRINT_ERROR_CANCELED;
+    fake_run_locked(ctx, {step});
+
+    return 0;
+}
+
+static int fake_enumerate(struct fingerprint_device* dev) {
+    fake_context_t* ctx = fake_context(dev);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    std::vector<fake_step_t> steps;
+
+    uint32_t remaining = ctx->fids.size();
+    for (uint32_t fid : ctx->fids) {
+        fake_step_t step = fake_make_step(FINGERPRINT_TEMPLATE_ENUMERATING);
+        step.msg.data.enumerated.finger = {.gid = ctx->gid, .fid = fid};
+        step.msg.data.enumerated.remaining_templates = --remaining;
+        steps.push_back(step);
+    }
+    if (steps.empty()) {
+        fake_step_t step = fake_make_step(FINGERPRINT_TEMPLATE_ENUMERATING);
+        step.msg.data.enumerated.finger.gid = ctx->gid;
+        steps.push_back(step);
+    }
+    fake_run_locked(ctx, steps);
+
+    return 0;
+}
+
+static int fake_remove(struct fingerprint_device* dev, uint32_t gid, uint32_t fid) {
+    fake_context_t* ctx = fake_context(dev);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    std::vector<fake_step_t> steps;
+
+    // fid 0 removes all the templates of the group
+    std::vector<uint32_t> removed;
+    for (uint32_t enrolled : ctx->fids) {
+        if (fid == 0 || fid == enrolled) {
+            removed.push_back(enrolled);
+        }
+    }
+
+    uint32_t remaining = removed.size();
+    for (uint32_t enrolled : removed) {
+        ctx->fids.erase(enrolled);
+
+        fake_step_t step = fake_make_step(FINGERPRINT_TEMPLATE_REMOVED);
+        step.msg.data.removed.finger = {.gid = gid, .fid = enrolled};
+        step.msg.data.removed.remaining_templates = --remaining;
+        steps.push_back(step);
+    }
+    if (steps.empty()) {
+        fake_step_t step = fake_make_step(FINGERPRINT_TEMPLATE_REMOVED);
+        step.msg.data.removed.finger.gid = gid;
+        steps.push_back(step);
+    }
+    fake_run_locked(ctx, steps);
+
+    return 0;
+}
+
+static int fake_set_active_group(struct fingerprint_device* dev, uint32_t gid,
+                                 const char* /* store_path */) {
+    fake_context_t* ctx = fake_context(dev);
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+
+    ctx->gid = gid;
+
+    return 0;
+}
+
+static int fake_authenticate(struct fingerprint_device* dev, uint64_t operation_id,
+                             uint32_t /* gid */) {
+    return fake_run_script(fake_context(dev), kAuthenticateScriptProp, kDefaultAuthenticateScript,
+                           0, operation_id);
+}
+
+static int fake_ext_cmd(struct fingerprint_device* /* dev */, int32_t /* cmd */,
+                        int32_t /* param */) {
+    return 0;
+}
+
+static int fake_close(struct hw_device_t* dev) {
+    fake_context_t* ctx = reinterpret_cast<fake_context_t*>(dev);
+
+    if (ctx) {
+        {
+            std::lock_guard<std::mutex> lock(ctx->mutex);
+            ctx->exiting = true;
+        }
+        ctx->condition.notify_one();
+        ctx->thread.join();
+        delete ctx;
+    }
+
+    return 0;
+}
+
+static int fake_open(const struct hw_module_t* module, const char* /* name */,
+                     struct hw_device_t** device) {
+    fake_context_t* ctx = new fake_context_t();
+
+    memset(&ctx->device, 0, sizeof(ctx->device));
+    ctx->device.common.tag = HARDWARE_DEVICE_TAG;
+    ctx->device.common.version = FINGERPRINT_MODULE_API_VERSION_2_1;
+    ctx->device.common.module = const_cast<hw_module_t*>(module);
+    ctx->device.common.close = fake_close;
+    ctx->device.set_notify = fake_set_notify;
+    ctx->device.pre_enroll = fake_pre_enroll;
+    ctx->device.enroll = fake_enroll;
+    ctx->device.post_enroll = fake_post_enroll;
+    ctx->device.get_authenticator_id = fake_get_authenticator_id;
+    ctx->device.cancel = fake_cancel;
+    ctx->device.enumerate = fake_enumerate;
+    ctx->device.remove = fake_remove;
+    ctx->device.set_active_group = fake_set_active_group;
+    ctx->device.authenticate = fake_authenticate;
+    ctx->device.extCmd = fake_ext_cmd;
+    ctx->exiting = false;
+    ctx->gid = 0;
+    ctx->challenge = 0;
+    ctx->thread = std::thread(fake_thread_loop, ctx);
+
+    *device = &ctx->device.common;
+
+    return 0;
+}
+
+static struct hw_module_methods_t fake_module_methods = {
+        .open = fake_open,
+};
+
+fingerprint_module_t HAL_MODULE_INFO_SYM = {
+        .common = {.tag = HARDWARE_MODULE_TAG,
+                   .module_api_version = FINGERPRINT_MODULE_API_VERSION_2_1,
+                   .hal_api_version = HARDWARE_HAL_API_VERSION,
+                   .id = FINGERPRINT_HARDWARE_MODULE_ID,
+                   .name = "Fake fingerprint module",
+                   .author = "The LineageOS Project",
+                   .methods = &fake_module_methods,
+                   .dso = NULL,
+                   .reserved = {0}},
+};
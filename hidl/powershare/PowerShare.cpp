@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2020 The LineageOS Project
+ * Copyright (C) 2020-2024 The LineageOS Project
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -7,8 +7,16 @@
 #define LOG_TAG "PowerShareService"
 
 #include "PowerShare.h"
+#include <android-base/logging.h>
+#include <cutils/uevent.h>
+#include <errno.h>
 #include <hidl/HidlTransportSupport.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
 #include <fstream>
+#include <vector>
 
 namespace vendor {
 namespace lineage {
@@ -16,6 +24,8 @@ namespace powershare {
 namespace V1_0 {
 namespace implementation {
 
+static constexpr int kUeventBufferSize = 64 * 1024;
+
 /*
  * Write value to path and close file.
  */
@@ -34,15 +44,119 @@ static T get(const std::string& path, const T& def) {
     return file.fail() ? def : result;
 }
 
-Return<bool> PowerShare::isEnabled() {
-    const auto value = get<std::string>(WIRELESS_TX_ENABLE_PATH, "0");
+/*
+ * A uevent is an "action@devpath" header followed by NUL separated KEY=VALUE pairs.
+ */
+static bool isPowerSupplyUevent(const char* msg, size_t len) {
+    static const char kSubsystem[] = "SUBSYSTEM=power_supply";
+
+    for (size_t i = 0; i < len;) {
+        const size_t fieldLen = strnlen(msg + i, len - i);
+        if (fieldLen == sizeof(kSubsystem) - 1 && memcmp(msg + i, kSubsystem, fieldLen) == 0) {
+            return true;
+        }
+        i += fieldLen + 1;
+    }
+
+    return false;
+}
+
+PowerShare::PowerShare()
+    : PowerShare(WIRELESS_TX_ENABLE_PATH,
+                 ::android::base::unique_fd(uevent_open_socket(kUeventBufferSize, true))) {}
+
+PowerShare::PowerShare(std::string enablePath, ::android::base::unique_fd ueventSocket)
+    : mEnablePath(std::move(enablePath)),
+      mUeventSocket(std::move(ueventSocket)),
+      mEventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      mEnabled(readEnabled()),
+      mListening(mUeventSocket >= 0 && mEventFd >= 0) {
+    if (!mListening) {
+        PLOG(ERROR) << "Failed to set up uevent listener, reading " << mEnablePath
+                    << " on every call";
+        return;
+    }
+
+    mThread = std::thread(&PowerShare::ueventThreadLoop, this);
+}
+
+PowerShare::~PowerShare() {
+    if (mThread.joinable()) {
+        eventfd_write(mEventFd, 1);
+        mThread.join();
+    }
+}
+
+bool PowerShare::readEnabled() const {
+    const auto value = get<std::string>(mEnablePath, "0");
     return !(value == "disable" || value == "0");
 }
 
+void PowerShare::ueventThreadLoop() {
+    struct pollfd fds[] = {
+            {.fd = mUeventSocket, .events = POLLIN},
+            {.fd = mEventFd, .events = POLLIN},
+    };
+    std::vector<char> msg(kUeventBufferSize);
+
+    while (true) {
+        if (TEMP_FAILURE_RETRY(poll(fds, std::size(fds), -1)) < 0) {
+            PLOG(ERROR) << "Failed to poll";
+            break;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            return;
+        }
+
+        if (fds[0].revents == 0) {
+            continue;
+        }
+
+        const ssize_t len = TEMP_FAILURE_RETRY(recv(mUeventSocket, msg.data(), msg.size(), 0));
+        if (len < 0 && errno == EAGAIN) {
+            continue;
+        }
+        if (len < 0 && errno != ENOBUFS) {
+            PLOG(ERROR) << "Failed to receive uevent";
+            break;
+        }
+        if (len == 0 && (fds[0].revents & POLLHUP)) {
+            LOG(ERROR) << "Uevent socket closed";
+            break;
+        }
+
+        // ENOBUFS means the socket overflowed and we may have missed a change
+        if (len > 0 && !isPowerSupplyUevent(msg.data(), len)) {
+            continue;
+        }
+
+        // Only the subsystem is taken from the message, the state always comes from the node
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEnabled = readEnabled();
+    }
+
+    // Without the listener, fall back to reading the node on every call
+    mListening = false;
+}
+
+Return<bool> PowerShare::isEnabled() {
+    if (!mListening) {
+        return readEnabled();
+    }
+
+    return mEnabled.load();
+}
+
 Return<bool> PowerShare::setEnabled(bool enable) {
-    set(WIRELESS_TX_ENABLE_PATH, enable ? 1 : 0);
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    set(mEnablePath, enable ? 1 : 0);
 
-    return isEnabled();
+    // The driver may reject the value, read it back right away. Later changes, e.g. the driver
+    // turning wireless TX off on its own, come with a power_supply uevent updating the cache.
+    mEnabled = readEnabled();
+    return mEnabled.load();
 }
 
 Return<uint32_t> PowerShare::getMinBattery() {
@@ -1,12 +1,17 @@
 /*
- * Copyright (C) 2020-2022 The LineageOS Project
+ * Copyright (C) 2020-2024 The LineageOS Project
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
 #pragma once
 
+#include <android-base/unique_fd.h>
 #include <vendor/lineage/powershare/1.0/IPowerShare.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
 
 namespace vendor {
 namespace lineage {
@@ -18,12 +23,40 @@ using ::android::sp;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
 
+/*
+ * The wireless TX state is cached and only read back from the enable node after writing it, or
+ * when a power_supply uevent reports that something changed.
+ */
 class PowerShare : public IPowerShare {
   public:
+    PowerShare();
+
+    /*
+     * @param enablePath The wireless TX enable node
+     * @param ueventSocket A socket receiving kernel uevents, as NETLINK_KOBJECT_UEVENT messages.
+     *                     Without one, the enable node is read on every call.
+     */
+    PowerShare(std::string enablePath, ::android::base::unique_fd ueventSocket);
+    ~PowerShare();
+
     Return<bool> isEnabled() override;
     Return<bool> setEnabled(bool enable) override;
     Return<uint32_t> getMinBattery() override;
     Return<uint32_t> setMinBattery(uint32_t minBattery) override;
+
+  private:
+    bool readEnabled() const;
+    void ueventThreadLoop();
+
+    const std::string mEnablePath;
+    ::android::base::unique_fd mUeventSocket;
+    ::android::base::unique_fd mEventFd;
+
+    std::mutex mMutex;
+    std::atomic<bool> mEnabled;
+    std::atomic<bool> mListening;
+
+    std::thread mThread;
 };
 
 }  // namespace implementation
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "PowerShare.h"
+
+using ::android::base::unique_fd;
+using ::vendor::lineage::powershare::V1_0::implementation::PowerShare;
+
+namespace {
+
+constexpr auto kUeventDeadline = std::chrono::seconds(2);
+// How long an ignored uevent gets to (wrongly) reach the cache
+constexpr auto kIgnoredUeventDelay = std::chrono::milliseconds(50);
+
+const char kPowerSupplyUevent[] =
+        "change@/devices/platform/wireless/power_supply/wireless\0ACTION=change\0"
+        "SUBSYSTEM=power_supply";
+const char kInputUevent[] = "change@/devices/platform/touch/input/input0\0ACTION=change\0"
+                            "SUBSYSTEM=input";
+
+class PowerShareTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Keeps message boundaries like the netlink socket, and reports the peer closing
+        int sockets[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets), 0);
+        mKernelSocket.reset(sockets[1]);
+        mUeventSocket.reset(sockets[0]);
+
+        writeNode("0");
+    }
+
+    // Changes the node behind the HAL, like the driver does
+    void writeNode(const std::string& value) {
+        std::ofstream file(mEnableFile.path);
+        file << value;
+    }
+
+    std::string readNode() {
+        std::ifstream file(mEnableFile.path);
+        std::string value;
+        file >> value;
+        return value;
+    }
+
+    void sendUevent(const char* msg, size_t len) {
+        ASSERT_EQ(send(mKernelSocket, msg, len, 0), static_cast<ssize_t>(len));
+    }
+
+    std::unique_ptr<PowerShare> create() {
+        return std::make_unique<PowerShare>(mEnableFile.path, std::move(mUeventSocket));
+    }
+
+    static bool waitFor(const std::function<bool()>& condition) {
+        const auto deadline = std::chrono::steady_clock::now() + kUeventDeadline;
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    TemporaryFile mEnableFile;
+    unique_fd mKernelSocket;
+    unique_fd mUeventSocket;
+};
+
+TEST_F(PowerShareTest, InitialStateFromNode) {
+    writeNode("1");
+    EXPECT_TRUE(create()->isEnabled());
+}
+
+TEST_F(PowerShareTest, DisabledStrings) {
+    writeNode("disable");
+    EXPECT_FALSE(create()->isEnabled());
+}
+
+TEST_F(PowerShareTest, SetEnabledWritesNode) {
+    auto powerShare = create();
+
+    EXPECT_TRUE(powerShare->setEnabled(true));
+    EXPECT_EQ(readNode(), "1");
+    EXPECT_TRUE(powerShare->isEnabled());
+
+    EXPECT_FALSE(powerShare->setEnabled(false));
+    EXPECT_EQ(readNode(), "0");
+    EXPECT_FALSE(powerShare->isEnabled());
+}
+
+TEST_F(PowerShareTest, SetEnabledDoesNotWaitForUevent) {
+    auto powerShare = create();
+
+    const auto start = std::chrono::steady_clock::now();
+    powerShare->setEnabled(true);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+}
+
+TEST_F(PowerShareTest, PowerSupplyUeventUpdatesState) {
+    auto powerShare = create();
+    ASSERT_FALSE(powerShare->isEnabled());
+
+    writeNode("1");
+    sendUevent(kPowerSupplyUevent, sizeof(kPowerSupplyUevent));
+    EXPECT_TRUE(waitFor([&] { return powerShare->isEnabled(); }));
+
+    writeNode("0");
+    sendUevent(kPowerSupplyUevent, sizeof(kPowerSupplyUevent));
+    EXPECT_TRUE(waitFor([&] { return !powerShare->isEnabled(); }));
+}
+
+TEST_F(PowerShareTest, OtherUeventsIgnored) {
+    auto powerShare = create();
+
+    writeNode("1");
+    sendUevent(kInputUevent, sizeof(kInputUevent));
+    std::this_thread::sleep_for(kIgnoredUeventDelay);
+    EXPECT_FALSE(powerShare->isEnabled());
+}
+
+TEST_F(PowerShareTest, SocketClosedFallsBackToNode) {
+    auto powerShare = create();
+
+    mKernelSocket.reset();
+    writeNode("1");
+    EXPECT_TRUE(waitFor([&] { return powerShare->isEnabled(); }));
+}
+
+TEST_F(PowerShareTest, NoSocketReadsNode) {
+    auto powerShare = std::make_unique<PowerShare>(mEnableFile.path, unique_fd());
+
+    writeNode("1");
+    EXPECT_TRUE(powerShare->isEnabled());
+    writeNode("0");
+    EXPECT_FALSE(powerShare->isEnabled());
+}
+
+TEST_F(PowerShareTest, MinBatteryUnsupported) {
+    auto powerShare = create();
+
+    EXPECT_EQ(powerShare->getMinBattery(), 0u);
+    EXPECT_EQ(powerShare->setMinBattery(20), 0u);
+}
+
+}  // namespace
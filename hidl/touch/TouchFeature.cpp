@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "TouchFeatureService"
+
+#include "TouchFeature.h"
+
+#include <errno.h>
+
+namespace vendor {
+namespace xiaomi {
+namespace hw {
+namespace touchfeature {
+namespace V1_0 {
+namespace implementation {
+
+static const char* const kTouchDevPath = "/dev/xiaomi-touch";
+
+TouchFeature::TouchFeature() : mEngine(kTouchDevPath) {}
+
+Return<int32_t> TouchFeature::getModeCurValue(int32_t touchId, int32_t mode) {
+    const auto values = mEngine.getValues(touchId, mode);
+    return values ? values->cur : -ENODEV;
+}
+
+Return<int32_t> TouchFeature::getModeDefaultValue(int32_t touchId, int32_t mode) {
+    const auto values = mEngine.getValues(touchId, mode);
+    return values ? values->def : -ENODEV;
+}
+
+Return<int32_t> TouchFeature::getModeMaxValue(int32_t touchId, int32_t mode) {
+    const auto values = mEngine.getValues(touchId, mode);
+    return values ? values->max : -ENODEV;
+}
+
+Return<int32_t> TouchFeature::getModeMinValue(int32_t touchId, int32_t mode) {
+    const auto values = mEngine.getValues(touchId, mode);
+    return values ? values->min : -ENODEV;
+}
+
+Return<void> TouchFeature::getModeValue(int32_t touchId, int32_t mode, getModeValue_cb _hidl_cb) {
+    const auto values = mEngine.getValues(touchId, mode);
+    if (!values) {
+        _hidl_cb({});
+        return Void();
+    }
+
+    _hidl_cb({values->cur, values->def, values->min, values->max});
+    return Void();
+}
+
+Return<int32_t> TouchFeature::modeReset(int32_t touchId, int32_t mode) {
+    return mEngine.resetMode(touchId, mode);
+}
+
+Return<int32_t> TouchFeature::setModeLongValue(int32_t touchId, int32_t mode, uint32_t valueLen,
+                                               const hidl_vec<int32_t>& valueBuf) {
+    if (valueLen > valueBuf.size()) {
+        return -EINVAL;
+    }
+
+    if (mode != TOUCH_MODE_PROFILE) {
+        return mEngine.setLongValue(touchId, mode,
+                                    std::vector<int32_t>(valueBuf.begin(),
+                                                         valueBuf.begin() + valueLen));
+    }
+
+    if (valueLen % 2 != 0) {
+        return -EINVAL;
+    }
+
+    std::vector<std::pair<int32_t, int32_t>> settings;
+    for (uint32_t i = 0; i < valueLen; i += 2) {
+        settings.emplace_back(valueBuf[i], valueBuf[i + 1]);
+    }
+
+    return mEngine.applyProfile(touchId, settings);
+}
+
+Return<int32_t> TouchFeature::setModeValue(int32_t touchId, int32_t mode, int32_t value) {
+    return mEngine.setValue(touchId, mode, value);
+}
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace touchfeature
+}  // namespace hw
+}  // namespace xiaomi
+}  // namespace vendor
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <vendor/xiaomi/hw/touchfeature/1.0/ITouchFeature.h>
+#include "TouchModeEngine.h"
+
+namespace vendor {
+namespace xiaomi {
+namespace hw {
+namespace touchfeature {
+namespace V1_0 {
+namespace implementation {
+
+using ::android::hardware::hidl_vec;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+
+class TouchFeature : public ITouchFeature {
+  public:
+    TouchFeature();
+
+    // Methods from ::vendor::xiaomi::hw::touchfeature::V1_0::ITouchFeature follow.
+    Return<int32_t> getModeCurValue(int32_t touchId, int32_t mode) override;
+    Return<int32_t> getModeDefaultValue(int32_t touchId, int32_t mode) override;
+    Return<int32_t> getModeMaxValue(int32_t touchId, int32_t mode) override;
+    Return<int32_t> getModeMinValue(int32_t touchId, int32_t mode) override;
+    Return<void> getModeValue(int32_t touchId, int32_t mode, getModeValue_cb _hidl_cb) override;
+    Return<int32_t> modeReset(int32_t touchId, int32_t mode) override;
+    // With TOUCH_MODE_PROFILE, values are (mode, value) pairs applied as a single profile
+    Return<int32_t> setModeLongValue(int32_t touchId, int32_t mode, uint32_t valueLen,
+                                     const hidl_vec<int32_t>& valueBuf) override;
+    Return<int32_t> setModeValue(int32_t touchId, int32_t mode, int32_t value) override;
+
+  private:
+    TouchModeEngine mEngine;
+};
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace touchfeature
+}  // namespace hw
+}  // namespace xiaomi
+}  // namespace vendor
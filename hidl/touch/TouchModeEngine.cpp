@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "TouchModeEngine"
+
+#include "TouchModeEngine.h"
+
+#include <android-base/logging.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <algorithm>
+#include <array>
+
+namespace vendor {
+namespace xiaomi {
+namespace hw {
+namespace touchfeature {
+namespace V1_0 {
+namespace implementation {
+
+// ioctl ABI of the xiaomi_touch driver
+enum {
+    SET_CUR_VALUE = 0,
+    GET_CUR_VALUE,
+    GET_DEF_VALUE,
+    GET_MIN_VALUE,
+    GET_MAX_VALUE,
+    GET_MODE_VALUE,
+    RESET_MODE,
+    SET_LONG_VALUE,
+};
+
+static constexpr int kTouchMagic = 'T';
+static constexpr size_t kMaxBufSize = 256;
+
+// Header of a command buffer: touch id, mode, then the value or the long value length
+static constexpr size_t kHeaderSize = 3;
+
+TouchModeEngine::TouchModeEngine(const std::string& devicePath)
+    : mFd(open(devicePath.c_str(), O_RDWR | O_CLOEXEC)) {
+    if (mFd < 0) {
+        PLOG(ERROR) << "Failed to open " << devicePath;
+    }
+}
+
+int32_t TouchModeEngine::command(unsigned int nr, int32_t* buf) {
+    if (mFd < 0) {
+        return -ENODEV;
+    }
+
+    int ret = TEMP_FAILURE_RETRY(ioctl(mFd, _IO(kTouchMagic, nr), buf));
+    if (ret < 0) {
+        PLOG(ERROR) << "Touch command " << nr << " for mode " << buf[1] << " failed";
+        return -errno;
+    }
+
+    return ret;
+}
+
+const TouchModeEngine::ModeRange* TouchModeEngine::getRangeLocked(int32_t touchId,
+                                                                  int32_t mode) {
+    auto it = mRanges.find({touchId, mode});
+    if (it != mRanges.end()) {
+        return &it->second;
+    }
+
+    // The driver returns cur, def, min and max at the start of the buffer
+    std::array<int32_t, kMaxBufSize> buf = {touchId, mode};
+    if (command(GET_MODE_VALUE, buf.data()) < 0) {
+        return nullptr;
+    }
+
+    const ModeRange range = {.def = buf[1], .min = buf[2], .max = buf[3]};
+    return &mRanges.emplace(ModeKey(touchId, mode), range).first->second;
+}
+
+int32_t TouchModeEngine::checkRangeLocked(int32_t touchId, int32_t mode, int32_t value) {
+    const ModeRange* range = getRangeLocked(touchId, mode);
+    if (range == nullptr) {
+        return -ENODEV;
+    }
+    if (value < range->min || value > range->max) {
+        LOG(ERROR) << "Value " << value << " out of range for mode " << mode << " (" << range->min
+                   << "-" << range->max << ")";
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+int32_t TouchModeEngine::getCurValueLocked(int32_t touchId, int32_t mode, int32_t* value) {
+    // The driver returns the value at the start of the buffer
+    std::array<int32_t, kMaxBufSize> buf = {touchId, mode};
+    int32_t ret = command(GET_CUR_VALUE, buf.data());
+    if (ret < 0) {
+        return ret;
+    }
+
+    *value = buf[0];
+    return 0;
+}
+
+int32_t TouchModeEngine::setValueLocked(int32_t touchId, int32_t mode, int32_t value) {
+    int32_t ret = checkRangeLocked(touchId, mode, value);
+    if (ret < 0) {
+        return ret;
+    }
+
+    int32_t cur;
+    if (getCurValueLocked(touchId, mode, &cur) == 0 && cur == value) {
+        return 0;
+    }
+
+    std::array<int32_t, kMaxBufSize> buf = {touchId, mode, value};
+    return command(SET_CUR_VALUE, buf.data());
+}
+
+std::optional<TouchModeEngine::ModeValues> TouchModeEngine::getValues(int32_t touchId,
+                                                                      int32_t mode) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const ModeRange* range = getRangeLocked(touchId, mode);
+    if (range == nullptr) {
+        return std::nullopt;
+    }
+
+    int32_t cur;
+    if (getCurValueLocked(touchId, mode, &cur) < 0) {
+        return std::nullopt;
+    }
+
+    return ModeValues{.cur = cur, .def = range->def, .min = range->min, .max = range->max};
+}
+
+int32_t TouchModeEngine::setValue(int32_t touchId, int32_t mode, int32_t value) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    return setValueLocked(touchId, mode, value);
+}
+
+int32_t TouchModeEngine::resetMode(int32_t touchId, int32_t mode) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::array<int32_t, kMaxBufSize> buf = {touchId, mode};
+    return command(RESET_MODE, buf.data());
+}
+
+int32_t TouchModeEngine::setLongValue(int32_t touchId, int32_t mode,
+                                      const std::vector<int32_t>& values) {
+    if (values.size() > kMaxBufSize - kHeaderSize) {
+        return -EINVAL;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::array<int32_t, kMaxBufSize> buf = {touchId, mode, static_cast<int32_t>(values.size())};
+    std::copy(values.begin(), values.end(), buf.begin() + kHeaderSize);
+    return command(SET_LONG_VALUE, buf.data());
+}
+
+int32_t TouchModeEngine::applyProfile(int32_t touchId,
+                                      const std::vector<std::pair<int32_t, int32_t>>& settings) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (const auto& [mode, value] : settings) {
+        int32_t ret = checkRangeLocked(touchId, mode, value);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    for (const auto& [mode, value] : settings) {
+        int32_t ret = setValueLocked(touchId, mode, value);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace touchfeature
+}  // namespace hw
+}  // namespace xiaomi
+}  // namespace vendor
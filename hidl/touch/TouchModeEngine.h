@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vendor {
+namespace xiaomi {
+namespace hw {
+namespace touchfeature {
+namespace V1_0 {
+namespace implementation {
+
+enum TouchMode : int32_t {
+    // Not a driver mode, setModeLongValue() with it applies a profile, see applyProfile()
+    TOUCH_MODE_PROFILE = 1000,
+};
+
+/*
+ * Mode table of the xiaomi_touch driver, behind /dev/xiaomi-touch.
+ *
+ * The default, minimum and maximum value of a mode are fixed. They are fetched with a single
+ * ioctl the first time the mode is used and cached from then on, so values are range checked
+ * without reaching the driver. The driver changes current values on its own, e.g. when game mode
+ * is switched, so they are always read back. Writes of the current value are skipped.
+ */
+class TouchModeEngine {
+  public:
+    struct ModeValues {
+        int32_t cur;
+        int32_t def;
+        int32_t min;
+        int32_t max;
+    };
+
+    explicit TouchModeEngine(const std::string& devicePath);
+
+    std::optional<ModeValues> getValues(int32_t touchId, int32_t mode);
+    int32_t setValue(int32_t touchId, int32_t mode, int32_t value);
+    int32_t resetMode(int32_t touchId, int32_t mode);
+    int32_t setLongValue(int32_t touchId, int32_t mode, const std::vector<int32_t>& values);
+
+    /*
+     * Apply a set of mode values at once, e.g. a game mode profile.
+     * All the values are checked against the mode ranges before any of them is written, and modes
+     * already at the requested value aren't written at all.
+     *
+     * @param settings (mode, value) pairs, applied in order
+     * @return 0 on success, a negative errno otherwise
+     */
+    int32_t applyProfile(int32_t touchId, const std::vector<std::pair<int32_t, int32_t>>& settings);
+
+  private:
+    using ModeKey = std::pair<int32_t, int32_t>;
+
+    struct ModeRange {
+        int32_t def;
+        int32_t min;
+        int32_t max;
+    };
+
+    const ModeRange* getRangeLocked(int32_t touchId, int32_t mode);
+    int32_t checkRangeLocked(int32_t touchId, int32_t mode, int32_t value);
+    int32_t getCurValueLocked(int32_t touchId, int32_t mode, int32_t* value);
+    int32_t setValueLocked(int32_t touchId, int32_t mode, int32_t value);
+    int32_t command(unsigned int nr, int32_t* buf);
+
+    ::android::base::unique_fd mFd;
+
+    std::mutex mMutex;
+    std::map<ModeKey, ModeRange> mRanges;
+};
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace touchfeature
+}  // namespace hw
+}  // namespace xiaomi
+}  // namespace vendor
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "xiaomi.touchfeature@1.0-service.xiaomi"
+
+#include <android-base/logging.h>
+#include <hidl/HidlTransportSupport.h>
+
+#include "TouchFeature.h"
+
+using ::vendor::xiaomi::hw::touchfeature::V1_0::ITouchFeature;
+using ::vendor::xiaomi::hw::touchfeature::V1_0::implementation::TouchFeature;
+
+int main() {
+    android::sp<ITouchFeature> touchFeature = new TouchFeature();
+
+    android::hardware::configureRpcThreadpool(1, true);
+
+    if (touchFeature->registerAsService() != android::OK) {
+        LOG(ERROR) << "Cannot register touch feature HAL service.";
+        return 1;
+    }
+
+    LOG(INFO) << "Touch feature HAL service ready.";
+
+    android::hardware::joinRpcThreadpool();
+
+    LOG(ERROR) << "Touch feature HAL service failed to join thread pool.";
+    return 1;
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "SensorTrace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <log/log.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace trace {
+
+static_assert(sizeof(SensorTraceEvent::data) == sizeof(V2_1::EventPayload),
+              "event payload doesn't fit a trace record");
+
+// Events buffered before being handed to the writer thread, about 20KiB
+static constexpr size_t kBufferedEvents = 256;
+// Buffers waiting for the writer thread, about 160KiB
+static constexpr size_t kMaxQueuedBuffers = 8;
+
+static bool writeFully(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+
+    while (size > 0) {
+        ssize_t ret = TEMP_FAILURE_RETRY(write(fd, p, size));
+        if (ret <= 0) {
+            return false;
+        }
+        p += ret;
+        size -= ret;
+    }
+
+    return true;
+}
+
+static void copyString(char* dst, size_t size, const std::string& src) {
+    strncpy(dst, src.c_str(), size - 1);
+    dst[size - 1] = '\0';
+}
+
+SensorTraceWriter::SensorTraceWriter()
+    : mExiting(false), mOpen(false), mEventCount(0), mDroppedEventCount(0) {}
+
+SensorTraceWriter::~SensorTraceWriter() {
+    close();
+}
+
+bool SensorTraceWriter::open(const std::string& path,
+                             const std::vector<V2_1::SensorInfo>& sensors) {
+    close();
+
+    mFd.reset(TEMP_FAILURE_RETRY(
+            ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640)));
+    if (mFd < 0) {
+        ALOGE("Failed to create trace %s: %d", path.c_str(), -errno);
+        return false;
+    }
+
+    const SensorTraceHeader header = {
+            .magic = kSensorTraceMagic,
+            .version = kSensorTraceVersion,
+            .sensorCount = static_cast<uint32_t>(sensors.size()),
+            .eventSize = sizeof(SensorTraceEvent),
+    };
+
+    std::vector<SensorTraceSensor> table(sensors.size());
+    for (size_t i = 0; i < sensors.size(); i++) {
+        const V2_1::SensorInfo& sensor = sensors[i];
+        SensorTraceSensor& entry = table[i];
+
+        entry.handle = sensor.sensorHandle;
+        entry.type = static_cast<int32_t>(sensor.type);
+        entry.flags = sensor.flags;
+        entry.minDelay = sensor.minDelay;
+        entry.maxDelay = sensor.maxDelay;
+        entry.maxRange = sensor.maxRange;
+        entry.resolution = sensor.resolution;
+        entry.power = sensor.power;
+        copyString(entry.name, sizeof(entry.name), sensor.name);
+        copyString(entry.typeAsString, sizeof(entry.typeAsString), sensor.typeAsString);
+    }
+
+    if (!writeFully(mFd, &header, sizeof(header)) ||
+        !writeFully(mFd, table.data(), table.size() * sizeof(SensorTraceSensor))) {
+        ALOGE("Failed to write trace header: %d", -errno);
+        mFd.reset();
+        return false;
+    }
+
+    mBuffer.clear();
+    mBuffer.reserve(kBufferedEvents);
+    mExiting = false;
+    mEventCount = 0;
+    mDroppedEventCount = 0;
+    mOpen = true;
+    mThread = std::thread(&SensorTraceWriter::threadLoop, this);
+
+    return true;
+}
+
+void SensorTraceWriter::append(const std::vector<V2_1::Event>& events) {
+    if (!mOpen) {
+        return;
+    }
+
+    for (const V2_1::Event& event : events) {
+        SensorTraceEvent record;
+
+        record.timestamp = event.timestamp;
+        record.sensorHandle = event.sensorHandle;
+        record.sensorType = static_cast<int32_t>(event.sensorType);
+        memcpy(record.data, &event.u, sizeof(record.data));
+        mBuffer.push_back(record);
+
+        if (mBuffer.size() >= kBufferedEvents) {
+            queueBuffer();
+        }
+    }
+}
+
+void SensorTraceWriter::queueBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mQueuedBuffers.size() >= kMaxQueuedBuffers) {
+            mDroppedEventCount += mBuffer.size();
+            mBuffer.clear();
+            return;
+        }
+
+        mQueuedBuffers.push_back(std::move(mBuffer));
+        if (mFreeBuffers.empty()) {
+            mBuffer = Buffer();
+        } else {
+            mBuffer = std::move(mFreeBuffers.back());
+            mFreeBuffers.pop_back();
+        }
+    }
+    mCondition.notify_one();
+
+    mBuffer.reserve(kBufferedEvents);
+}
+
+void SensorTraceWriter::threadLoop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mCondition.wait(lock, [this] { return mExiting || !mQueuedBuffers.empty(); });
+        if (mQueuedBuffers.empty()) {
+            return;
+        }
+
+        Buffer buffer = std::move(mQueuedBuffers.front());
+        mQueuedBuffers.pop_front();
+        lock.unlock();
+
+        if (mFd >= 0) {
+            if (writeFully(mFd, buffer.data(), buffer.size() * sizeof(SensorTraceEvent))) {
+                mEventCount += buffer.size();
+            } else {
+                ALOGE("Failed to write trace, stopping: %d", -errno);
+                mFd.reset();
+                mOpen = false;
+            }
+        }
+        if (mFd < 0) {
+            mDroppedEventCount += buffer.size();
+        }
+        buffer.clear();
+
+        lock.lock();
+        mFreeBuffers.push_back(std::move(buffer));
+    }
+}
+
+void SensorTraceWriter::close() {
+    if (!mThread.joinable()) {
+        return;
+    }
+
+    if (!mBuffer.empty()) {
+        queueBuffer();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExiting = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+
+    if (mFd >= 0) {
+        ALOGI("Trace closed with %" PRIu64 " events, %" PRIu64 " dropped", mEventCount.load(),
+              mDroppedEventCount.load());
+    }
+    mFd.reset();
+    mOpen = false;
+}
+
+SensorTraceReader::SensorTraceReader()
+    : mData(MAP_FAILED),
+      mSize(0),
+      mSensors(nullptr),
+      mSensorCount(0),
+      mEvents(nullptr),
+      mEventCount(0) {}
+
+SensorTraceReader::~SensorTraceReader() {
+    if (mData != MAP_FAILED) {
+        munmap(mData, mSize);
+    }
+}
+
+bool SensorTraceReader::open(const std::string& path) {
+    ::android::base::unique_fd fd(TEMP_FAILURE_RETRY(::open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+    if (fd < 0) {
+        ALOGE("Failed to open trace %s: %d", path.c_str(), -errno);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(SensorTraceHeader)) {
+        ALOGE("Trace %s is too short", path.c_str());
+        return false;
+    }
+
+    mSize = st.st_size;
+    mData = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mData == MAP_FAILED) {
+        ALOGE("Failed to map trace %s: %d", path.c_str(), -errno);
+        return false;
+    }
+
+    const SensorTraceHeader* header = static_cast<const SensorTraceHeader*>(mData);
+    const size_t tableEnd =
+            sizeof(SensorTraceHeader) + header->sensorCount * sizeof(SensorTraceSensor);
+    if (header->magic != kSensorTraceMagic || header->version != kSensorTraceVersion ||
+        header->eventSize != sizeof(SensorTraceEvent) || tableEnd > mSize) {
+        ALOGE("Trace %s has an unsupported format", path.c_str());
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(mData);
+    mSensors = reinterpret_cast<const SensorTraceSensor*>(base + sizeof(SensorTraceHeader));
+    mSensorCount = header->sensorCount;
+    // A partial trailing record comes from a recording cut short, ignore it
+    mEvents = reinterpret_cast<const SensorTraceEvent*>(base + tableEnd);
+    mEventCount = (mSize - tableEnd) / sizeof(SensorTraceEvent);
+
+    return true;
+}
+
+V2_1::SensorInfo SensorTraceReader::getSensor(size_t index) const {
+    const SensorTraceSensor& entry = mSensors[index];
+    V2_1::SensorInfo sensor = {};
+
+    sensor.sensorHandle = entry.handle;
+    sensor.name = std::string(entry.name, strnlen(entry.name, sizeof(entry.name)));
+    sensor.vendor = "The LineageOS Project";
+    sensor.version = 1;
+    sensor.type = static_cast<V2_1::SensorType>(entry.type);
+    sensor.typeAsString = std::string(entry.typeAsString,
+                                      strnlen(entry.typeAsString, sizeof(entry.typeAsString)));
+    sensor.maxRange = entry.maxRange;
+    sensor.resolution = entry.resolution;
+    sensor.power = entry.power;
+    sensor.minDelay = entry.minDelay;
+    sensor.maxDelay = entry.maxDelay;
+    sensor.flags = entry.flags;
+
+    return sensor;
+}
+
+V2_1::Event SensorTraceReader::getEvent(size_t index) const {
+    const SensorTraceEvent& record = mEvents[index];
+    V2_1::Event event;
+
+    event.timestamp = record.timestamp;
+    event.sensorHandle = record.sensorHandle;
+    event.sensorType = static_cast<V2_1::SensorType>(record.sensorType);
+    memcpy(&event.u, record.data, sizeof(record.data));
+
+    return event;
+}
+
+}  // namespace trace
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <android/hardware/sensors/2.1/types.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace trace {
+
+/*
+ * Sensor event trace.
+ *
+ * Layout (native endianness, traces are read back on the same kind of device):
+ *   SensorTraceHeader
+ *   SensorTraceSensor[sensorCount]
+ *   SensorTraceEvent[], up to the end of the file
+ *
+ * Every record has a fixed size, so a trace can be used in place through a single mmap, and a
+ * recording cut short still holds every event written before.
+ */
+
+static constexpr uint32_t kSensorTraceMagic = 0x52544e53; /* "SNTR" */
+static constexpr uint32_t kSensorTraceVersion = 1;
+
+struct SensorTraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sensorCount;
+    uint32_t eventSize;
+};
+
+struct SensorTraceSensor {
+    int32_t handle;
+    int32_t type;
+    uint32_t flags;
+    int32_t minDelay;
+    int32_t maxDelay;
+    float maxRange;
+    float resolution;
+    float power;
+    char name[64];
+    char typeAsString[64];
+};
+
+struct SensorTraceEvent {
+    int64_t timestamp;
+    int32_t sensorHandle;
+    int32_t sensorType;
+    float data[16];
+};
+
+/*
+ * Appends events to a trace.
+ *
+ * append() only copies the events into a buffer, full buffers are written by a dedicated thread,
+ * so that the event path never waits for storage. When the thread falls too far behind, events
+ * are dropped from the trace rather than delaying append().
+ * open(), append() and close() aren't thread safe, callers serialize access.
+ */
+class SensorTraceWriter {
+  public:
+    SensorTraceWriter();
+    ~SensorTraceWriter();
+
+    bool open(const std::string& path, const std::vector<V2_1::SensorInfo>& sensors);
+    void append(const std::vector<V2_1::Event>& events);
+    void close();
+
+    bool isOpen() const { return mOpen; }
+    // Events written to the file
+    uint64_t getEventCount() const { return mEventCount; }
+    // Events left out of the trace because the writer thread fell behind
+    uint64_t getDroppedEventCount() const { return mDroppedEventCount; }
+
+  private:
+    using Buffer = std::vector<SensorTraceEvent>;
+
+    void queueBuffer();
+    void threadLoop();
+
+    // Only used by append(), until handed to the writer thread
+    Buffer mBuffer;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Buffer> mQueuedBuffers;
+    std::vector<Buffer> mFreeBuffers;
+    bool mExiting;
+
+    // Only used by the writer thread while it runs
+    ::android::base::unique_fd mFd;
+
+    std::atomic<bool> mOpen;
+    std::atomic<uint64_t> mEventCount;
+    std::atomic<uint64_t> mDroppedEventCount;
+    std::thread mThread;
+};
+
+/*
+ * Maps a trace for reading.
+ */
+class SensorTraceReader {
+  public:
+    SensorTraceReader();
+    ~SensorTraceReader();
+
+    bool open(const std::string& path);
+
+    size_t getSensorCount() const { return mSensorCount; }
+    size_t getEventCount() const { return mEventCount; }
+    V2_1::SensorInfo getSensor(size_t index) const;
+    V2_1::Event getEvent(size_t index) const;
+
+  private:
+    void* mData;
+    size_t mSize;
+    const SensorTraceSensor* mSensors;
+    size_t mSensorCount;
+    const SensorTraceEvent* mEvents;
+    size_t mEventCount;
+};
+
+}  // namespace trace
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
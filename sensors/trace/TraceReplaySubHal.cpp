@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "TraceReplaySubHal.h"
+
+#include <android-base/file.h>
+#include <cutils/properties.h>
+#include <log/log.h>
+#include <utils/SystemClock.h>
+#include <chrono>
+#include <sstream>
+
+using ::android::hardware::sensors::V2_1::implementation::ISensorsSubHal;
+using ::android::hardware::sensors::V2_1::subhal::implementation::TraceReplaySubHal;
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+using ::android::hardware::Void;
+using ::android::hardware::sensors::V1_0::MetaDataEventType;
+using ::android::hardware::sensors::V1_0::SensorFlagBits;
+using ::android::hardware::sensors::V2_0::implementation::ScopedWakelock;
+
+using Clock = std::chrono::steady_clock;
+
+// Events posted at once, the size of the framework event queue
+static constexpr size_t kMaxEventsPerPost = 256;
+// Sub-HALs don't see the proxy queues fill up, so replaying as fast as possible is paced to a
+// rate the framework keeps up with, about 25k events per second, rather than overflowing them
+static constexpr auto kFastReplayInterval = std::chrono::milliseconds(10);
+
+static std::string getTracePath() {
+    char path[PROPERTY_VALUE_MAX];
+    property_get("vendor.sensors.trace_replay.path", path, "");
+    return path;
+}
+
+static bool isReplayed(const Event& event) {
+    // Flushes are answered live, dynamic sensors and additional info don't map to the replay
+    return event.sensorType != SensorType::META_DATA &&
+           event.sensorType != SensorType::DYNAMIC_SENSOR_META &&
+           event.sensorType != SensorType::ADDITIONAL_INFO;
+}
+
+TraceReplaySubHal::TraceReplaySubHal()
+    : mPath(getTracePath()),
+      mSpeed(property_get_int32("vendor.sensors.trace_replay.speed", 100)),
+      mLoop(property_get_bool("vendor.sensors.trace_replay.loop", false)),
+      mCallback(nullptr),
+      mReplayedEventCount(0),
+      mExiting(false) {
+    if (mPath.empty() || !mReader.open(mPath)) {
+        return;
+    }
+
+    for (size_t i = 0; i < mReader.getSensorCount(); i++) {
+        SensorInfo sensor = mReader.getSensor(i);
+        const int32_t handle = static_cast<int32_t>(mSensors.size()) + 1;
+
+        mHandles[sensor.sensorHandle] = handle;
+        sensor.sensorHandle = handle;
+        sensor.name = "Replay " + std::string(sensor.name);
+        // Direct channels can't be replayed
+        sensor.flags &= ~(SensorFlagBits::MASK_DIRECT_REPORT | SensorFlagBits::MASK_DIRECT_CHANNEL);
+        mSensors.push_back(sensor);
+    }
+    mActive.resize(mSensors.size(), false);
+
+    ALOGI("Replaying %zu events of %zu sensors from %s", mReader.getEventCount(), mSensors.size(),
+          mPath.c_str());
+
+    if (mReader.getEventCount() > 0) {
+        mThread = std::thread(&TraceReplaySubHal::replayThreadLoop, this);
+    }
+}
+
+TraceReplaySubHal::~TraceReplaySubHal() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExiting = true;
+    }
+    mCondition.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+bool TraceReplaySubHal::isAnyActiveLocked() const {
+    for (bool active : mActive) {
+        if (active) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TraceReplaySubHal::replayThreadLoop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    const size_t eventCount = mReader.getEventCount();
+    const int64_t traceStart = mReader.getEvent(0).timestamp;
+
+    while (!mExiting) {
+        mCondition.wait(lock, [&] { return mExiting || isAnyActiveLocked(); });
+
+        const Clock::time_point replayStart = Clock::now();
+        const int64_t timestampStart = elapsedRealtimeNano();
+        auto scale = [&](int64_t timestamp) {
+            const int64_t offset = timestamp - traceStart;
+            return std::chrono::nanoseconds(mSpeed == 0 ? 0 : offset * 100 / mSpeed);
+        };
+
+        size_t next = 0;
+        while (!mExiting && isAnyActiveLocked() && next < eventCount) {
+            const Clock::time_point due = replayStart + scale(mReader.getEvent(next).timestamp);
+            if (mCondition.wait_until(lock, due, [&] { return mExiting; })) {
+                break;
+            }
+
+            // Post what is due in chunks, wake-up events need their own wakelock
+            const Clock::time_point now = Clock::now();
+            std::vector<Event> events;
+            std::vector<Event> wakeupEvents;
+            for (; next < eventCount && events.size() + wakeupEvents.size() < kMaxEventsPerPost;
+                 next++) {
+                Event event = mReader.getEvent(next);
+                const std::chrono::nanoseconds offset = scale(event.timestamp);
+                if (replayStart + offset > now) {
+                    break;
+                }
+
+                auto handle = mHandles.find(event.sensorHandle);
+                if (handle == mHandles.end() || !mActive[handle->second - 1] ||
+                    !isReplayed(event)) {
+                    continue;
+                }
+
+                event.sensorHandle = handle->second;
+                event.timestamp =
+                        mSpeed == 0 ? elapsedRealtimeNano() : timestampStart + offset.count();
+                if (mSensors[handle->second - 1].flags & SensorFlagBits::WAKE_UP) {
+                    wakeupEvents.push_back(event);
+                } else {
+                    events.push_back(event);
+                }
+            }
+            mReplayedEventCount += events.size() + wakeupEvents.size();
+            const sp<IHalProxyCallback> callback = mCallback;
+
+            lock.unlock();
+            postEvents(callback, events, false);
+            postEvents(callback, wakeupEvents, true);
+            lock.lock();
+
+            if (mSpeed == 0) {
+                mCondition.wait_for(lock, kFastReplayInterval, [&] { return mExiting; });
+            }
+        }
+
+        if (next >= eventCount && !mLoop) {
+            // Start over once the sensors have been disabled and enabled again
+            mCondition.wait(lock, [&] { return mExiting || !isAnyActiveLocked(); });
+        }
+    }
+}
+
+void TraceReplaySubHal::postEvents(const sp<IHalProxyCallback>& callback,
+                                   const std::vector<Event>& events, bool wakeup) {
+    if (events.empty() || callback == nullptr) {
+        return;
+    }
+
+    ScopedWakelock wakelock = callback->createScopedWakelock(wakeup);
+    callback->postEvents(events, std::move(wakelock));
+}
+
+Return<void> TraceReplaySubHal::getSensorsList_2_1(ISensors::getSensorsList_2_1_cb _hidl_cb) {
+    _hidl_cb(mSensors);
+    return Void();
+}
+
+Return<Result> TraceReplaySubHal::setOperationMode(OperationMode mode) {
+    return mode == OperationMode::NORMAL ? Result::OK : Result::BAD_VALUE;
+}
+
+Return<Result> TraceReplaySubHal::activate(int32_t sensorHandle, bool enabled) {
+    if (sensorHandle < 1 || static_cast<size_t>(sensorHandle) > mSensors.size()) {
+        return Result::BAD_VALUE;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mActive[sensorHandle - 1] = enabled;
+    }
+    mCondition.notify_all();
+
+    return Result::OK;
+}
+
+Return<Result> TraceReplaySubHal::batch(int32_t sensorHandle, int64_t /* samplingPeriodNs */,
+                                        int64_t /* maxReportLatencyNs */) {
+    // Events are replayed at the recorded rate
+    if (sensorHandle < 1 || static_cast<size_t>(sensorHandle) > mSensors.size()) {
+        return Result::BAD_VALUE;
+    }
+
+    return Result::OK;
+}
+
+Return<Result> TraceReplaySubHal::flush(int32_t sensorHandle) {
+    if (sensorHandle < 1 || static_cast<size_t>(sensorHandle) > mSensors.size()) {
+        return Result::BAD_VALUE;
+    }
+
+    sp<IHalProxyCallback> callback;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mActive[sensorHandle - 1]) {
+            return Result::BAD_VALUE;
+        }
+        callback = mCallback;
+    }
+
+    Event ev;
+    ev.sensorHandle = sensorHandle;
+    ev.sensorType = SensorType::META_DATA;
+    ev.u.meta.what = MetaDataEventType::META_DATA_FLUSH_COMPLETE;
+    postEvents(callback, {ev}, mSensors[sensorHandle - 1].flags & SensorFlagBits::WAKE_UP);
+
+    return Result::OK;
+}
+
+Return<Result> TraceReplaySubHal::injectSensorData_2_1(const Event& /* event */) {
+    return Result::INVALID_OPERATION;
+}
+
+Return<void> TraceReplaySubHal::registerDirectChannel(const SharedMemInfo& /* mem */,
+                                                      ISensors::registerDirectChannel_cb _hidl_cb) {
+    _hidl_cb(Result::INVALID_OPERATION, -1 /* channelHandle */);
+    return Return<void>();
+}
+
+Return<Result> TraceReplaySubHal::unregisterDirectChannel(int32_t /* channelHandle */) {
+    return Result::INVALID_OPERATION;
+}
+
+Return<void> TraceReplaySubHal::configDirectReport(int32_t /* sensorHandle */,
+                                                   int32_t /* channelHandle */,
+                                                   RateLevel /* rate */,
+                                                   ISensors::configDirectReport_cb _hidl_cb) {
+    _hidl_cb(Result::INVALID_OPERATION, 0 /* reportToken */);
+    return Return<void>();
+}
+
+Return<void> TraceReplaySubHal::debug(const hidl_handle& fd,
+                                      const hidl_vec<hidl_string>& /* args */) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        ALOGE("%s: missing fd for writing", __FUNCTION__);
+        return Void();
+    }
+
+    std::ostringstream stream;
+    stream << "Trace: " << (mPath.empty() ? "none" : mPath) << std::endl;
+    stream << "Recorded events: " << mReader.getEventCount() << std::endl;
+    stream << "Speed: " << mSpeed << "%, loop: " << (mLoop ? "true" : "false") << std::endl;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    stream << "Replayed events: " << mReplayedEventCount << std::endl;
+    for (size_t i = 0; i < mSensors.size(); i++) {
+        stream << "Name: " << mSensors[i].name << (mActive[i] ? " (active)" : "") << std::endl;
+    }
+    stream << std::endl;
+
+    ::android::base::WriteStringToFd(stream.str(), fd->data[0]);
+    return Return<void>();
+}
+
+Return<Result> TraceReplaySubHal::initialize(const sp<IHalProxyCallback>& halProxyCallback) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mCallback = halProxyCallback;
+
+    return Result::OK;
+}
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+
+ISensorsSubHal* sensorsHalGetSubHal_2_1(uint32_t* version) {
+    static TraceReplaySubHal subHal;
+    *version = SUB_HAL_2_1_VERSION;
+    return &subHal;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SensorTrace.h"
+#include "V2_1/SubHal.h"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace subhal {
+namespace implementation {
+
+using ::android::hardware::sensors::trace::SensorTraceReader;
+using ::android::hardware::sensors::V1_0::OperationMode;
+using ::android::hardware::sensors::V1_0::RateLevel;
+using ::android::hardware::sensors::V1_0::Result;
+using ::android::hardware::sensors::V1_0::SharedMemInfo;
+using ::android::hardware::sensors::V2_1::Event;
+using ::android::hardware::sensors::V2_1::implementation::IHalProxyCallback;
+using ::android::hardware::sensors::V2_1::implementation::ISensorsSubHal;
+
+/*
+ * Sub-HAL exposing the sensors of a recorded trace, see SensorTrace.h, and replaying the events of
+ * the enabled ones. The replay starts over whenever a sensor gets enabled while none was.
+ *
+ * Configured with:
+ *   vendor.sensors.trace_replay.path   trace to replay
+ *   vendor.sensors.trace_replay.speed  replay speed in percent of the original timing, 0 to post
+ *                                      events as fast as possible, at a steady rate the framework
+ *                                      keeps up with (default 100)
+ *   vendor.sensors.trace_replay.loop   start over at the end of the trace (default false)
+ */
+class TraceReplaySubHal : public ISensorsSubHal {
+  public:
+    TraceReplaySubHal();
+    ~TraceReplaySubHal();
+
+    Return<void> getSensorsList_2_1(ISensors::getSensorsList_2_1_cb _hidl_cb);
+    Return<Result> injectSensorData_2_1(const Event& event);
+    Return<Result> initialize(const sp<IHalProxyCallback>& halProxyCallback);
+
+    Return<Result> setOperationMode(OperationMode mode);
+
+    Return<Result> activate(int32_t sensorHandle, bool enabled);
+
+    Return<Result> batch(int32_t sensorHandle, int64_t samplingPeriodNs,
+                         int64_t maxReportLatencyNs);
+
+    Return<Result> flush(int32_t sensorHandle);
+
+    Return<void> registerDirectChannel(const SharedMemInfo& mem,
+                                       ISensors::registerDirectChannel_cb _hidl_cb);
+
+    Return<Result> unregisterDirectChannel(int32_t channelHandle);
+
+    Return<void> configDirectReport(int32_t sensorHandle, int32_t channelHandle, RateLevel rate,
+                                    ISensors::configDirectReport_cb _hidl_cb);
+
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& args);
+
+    const std::string getName() { return "TraceReplaySubHal"; }
+
+  private:
+    void replayThreadLoop();
+    bool isAnyActiveLocked() const;
+    void postEvents(const sp<IHalProxyCallback>& callback, const std::vector<Event>& events,
+                    bool wakeup);
+
+    const std::string mPath;
+    const uint32_t mSpeed;
+    const bool mLoop;
+    SensorTraceReader mReader;
+
+    // Sub-HAL handles are the index in mSensors + 1, mHandles maps the recorded ones to them
+    std::vector<SensorInfo> mSensors;
+    std::map<int32_t, int32_t> mHandles;
+
+    sp<IHalProxyCallback> mCallback;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<bool> mActive;
+    uint64_t mReplayedEventCount;
+    bool mExiting;
+
+    std::thread mThread;
+};
+
+}  // namespace implementation
+}  // namespace subhal
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <android-base/file.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "SensorTrace.h"
+
+using ::android::hardware::sensors::V2_1::Event;
+using ::android::hardware::sensors::V2_1::SensorInfo;
+using ::android::hardware::sensors::V2_1::SensorType;
+using ::android::hardware::sensors::trace::SensorTraceReader;
+using ::android::hardware::sensors::trace::SensorTraceWriter;
+
+namespace {
+
+// Not a multiple of the writer's buffer, so that close() has a partial buffer to flush
+constexpr size_t kEventCount = 1000;
+
+SensorInfo makeSensor(int32_t handle, SensorType type, const std::string& name) {
+    SensorInfo sensor = {};
+
+    sensor.sensorHandle = handle;
+    sensor.name = name;
+    sensor.type = type;
+    sensor.typeAsString = "android.sensor." + name;
+    sensor.maxRange = 100.0f;
+    sensor.resolution = 0.5f;
+    sensor.power = 0.25f;
+    sensor.minDelay = 5000;
+    sensor.maxDelay = 200000;
+    sensor.flags = 2;
+
+    return sensor;
+}
+
+Event makeEvent(size_t index) {
+    Event event;
+
+    event.timestamp = 1000000 * static_cast<int64_t>(index);
+    event.sensorHandle = 1 + index % 2;
+    event.sensorType = index % 2 ? SensorType::LIGHT : SensorType::ACCELEROMETER;
+    for (size_t i = 0; i < event.u.data.size(); i++) {
+        event.u.data[i] = index + i / 16.0f;
+    }
+
+    return event;
+}
+
+class SensorTraceTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        mPath = std::string(mDir.path) + "/trace";
+        mSensors = {
+                makeSensor(1, SensorType::ACCELEROMETER, "accelerometer"),
+                makeSensor(2, SensorType::LIGHT, "light"),
+        };
+    }
+
+    void writeTrace(size_t eventCount) {
+        SensorTraceWriter writer;
+        ASSERT_TRUE(writer.open(mPath, mSensors));
+        ASSERT_TRUE(writer.isOpen());
+
+        // Odd sized batches, as they come from the sub HALs
+        std::vector<Event> batch;
+        for (size_t i = 0; i < eventCount; i++) {
+            batch.push_back(makeEvent(i));
+            if (batch.size() == 7) {
+                writer.append(batch);
+                batch.clear();
+            }
+        }
+        writer.append(batch);
+        writer.close();
+
+        EXPECT_FALSE(writer.isOpen());
+        EXPECT_EQ(writer.getEventCount() + writer.getDroppedEventCount(), eventCount);
+        mWrittenCount = writer.getEventCount();
+    }
+
+    TemporaryDir mDir;
+    std::string mPath;
+    std::vector<SensorInfo> mSensors;
+    size_t mWrittenCount = 0;
+};
+
+TEST_F(SensorTraceTest, RoundTrip) {
+    writeTrace(kEventCount);
+    ASSERT_EQ(mWrittenCount, kEventCount);
+
+    SensorTraceReader reader;
+    ASSERT_TRUE(reader.open(mPath));
+
+    ASSERT_EQ(reader.getSensorCount(), mSensors.size());
+    for (size_t i = 0; i < mSensors.size(); i++) {
+        const SensorInfo sensor = reader.getSensor(i);
+        EXPECT_EQ(sensor.sensorHandle, mSensors[i].sensorHandle);
+        EXPECT_STREQ(sensor.name.c_str(), mSensors[i].name.c_str());
+        EXPECT_EQ(sensor.type, mSensors[i].type);
+        EXPECT_STREQ(sensor.typeAsString.c_str(), mSensors[i].typeAsString.c_str());
+        EXPECT_EQ(sensor.maxRange, mSensors[i].maxRange);
+        EXPECT_EQ(sensor.resolution, mSensors[i].resolution);
+        EXPECT_EQ(sensor.power, mSensors[i].power);
+        EXPECT_EQ(sensor.minDelay, mSensors[i].minDelay);
+        EXPECT_EQ(sensor.maxDelay, mSensors[i].maxDelay);
+        EXPECT_EQ(sensor.flags, mSensors[i].flags);
+    }
+
+    ASSERT_EQ(reader.getEventCount(), kEventCount);
+    for (size_t i = 0; i < kEventCount; i++) {
+        const Event expected = makeEvent(i);
+        const Event event = reader.getEvent(i);
+        EXPECT_EQ(event.timestamp, expected.timestamp);
+        EXPECT_EQ(event.sensorHandle, expected.sensorHandle);
+        EXPECT_EQ(event.sensorType, expected.sensorType);
+        for (size_t j = 0; j < event.u.data.size(); j++) {
+            EXPECT_EQ(event.u.data[j], expected.u.data[j]);
+        }
+    }
+}
+
+TEST_F(SensorTraceTest, EmptyTrace) {
+    writeTrace(0);
+
+    SensorTraceReader reader;
+    ASSERT_TRUE(reader.open(mPath));
+    EXPECT_EQ(reader.getSensorCount(), mSensors.size());
+    EXPECT_EQ(reader.getEventCount(), 0u);
+}
+
+TEST_F(SensorTraceTest, PartialRecordIgnored) {
+    writeTrace(10);
+    ASSERT_EQ(mWrittenCount, 10u);
+
+    // A recording cut short in the middle of a record
+    int fd = open(mPath.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    ASSERT_GE(fd, 0);
+    const char garbage[5] = {1, 2, 3, 4, 5};
+    ASSERT_EQ(write(fd, garbage, sizeof(garbage)), static_cast<ssize_t>(sizeof(garbage)));
+    close(fd);
+
+    SensorTraceReader reader;
+    ASSERT_TRUE(reader.open(mPath));
+    ASSERT_EQ(reader.getEventCount(), 10u);
+    EXPECT_EQ(reader.getEvent(9).timestamp, makeEvent(9).timestamp);
+}
+
+TEST_F(SensorTraceTest, ReopenTruncates) {
+    writeTrace(kEventCount);
+    writeTrace(3);
+
+    SensorTraceReader reader;
+    ASSERT_TRUE(reader.open(mPath));
+    EXPECT_EQ(reader.getEventCount(), 3u);
+}
+
+TEST_F(SensorTraceTest, BadMagicRejected) {
+    writeTrace(10);
+
+    int fd = open(mPath.c_str(), O_WRONLY | O_CLOEXEC);
+    ASSERT_GE(fd, 0);
+    const uint32_t magic = 0xdeadbeef;
+    ASSERT_EQ(write(fd, &magic, sizeof(magic)), static_cast<ssize_t>(sizeof(magic)));
+    close(fd);
+
+    SensorTraceReader reader;
+    EXPECT_FALSE(reader.open(mPath));
+}
+
+TEST_F(SensorTraceTest, MissingFileRejected) {
+    SensorTraceReader reader;
+    EXPECT_FALSE(reader.open(mPath));
+}
+
+TEST_F(SensorTraceTest, AppendWhenClosedIgnored) {
+    SensorTraceWriter writer;
+    writer.append({makeEvent(0)});
+    EXPECT_FALSE(writer.isOpen());
+    EXPECT_EQ(writer.getEventCount(), 0u);
+}
+
+}  // namespace
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "LatencyHistogram.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <sstream>
+
+namespace android {
+namespace hardware {
+namespace stats {
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration) {
+    const uint64_t us =
+            std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(duration)
+                                         .count());
+    const size_t bucket =
+            us == 0 ? 0 : std::min<size_t>(64 - __builtin_clzll(us), kBucketCount - 1);
+
+    mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mTotalUs.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t min = mMinUs.load(std::memory_order_relaxed);
+    while (us < min && !mMinUs.compare_exchange_weak(min, us, std::memory_order_relaxed)) {
+    }
+    uint64_t max = mMaxUs.load(std::memory_order_relaxed);
+    while (us > max && !mMaxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : mBuckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    mCount.store(0, std::memory_order_relaxed);
+    mTotalUs.store(0, std::memory_order_relaxed);
+    mMinUs.store(UINT64_MAX, std::memory_order_relaxed);
+    mMaxUs.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::dump(int fd) const {
+    std::ostringstream stream;
+    dump(stream);
+    dprintf(fd, "%s", stream.str().c_str());
+}
+
+void LatencyHistogram::dump(std::ostream& stream) const {
+    const uint64_t count = mCount.load(std::memory_order_relaxed);
+
+    stream << "count: " << count;
+    if (count == 0) {
+        return;
+    }
+
+    stream << ", min: " << mMinUs.load(std::memory_order_relaxed) << "us";
+    stream << ", avg: " << mTotalUs.load(std::memory_order_relaxed) / count << "us";
+    stream << ", max: " << mMaxUs.load(std::memory_order_relaxed) << "us";
+    stream << ", buckets:";
+    for (size_t i = 0; i < kBucketCount; i++) {
+        const uint64_t value = mBuckets[i].load(std::memory_order_relaxed);
+        if (value == 0) {
+            continue;
+        }
+
+        if (i == kBucketCount - 1) {
+            stream << " >=" << (uint64_t(1) << (i - 1)) << "us: " << value;
+        } else {
+            stream << " <" << (uint64_t(1) << i) << "us: " << value;
+        }
+    }
+}
+
+}  // namespace stats
+}  // namespace hardware
+}  // namespace android
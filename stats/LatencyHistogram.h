@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace android {
+namespace hardware {
+namespace stats {
+
+/**
+ * A lock free histogram of durations, with power of two microsecond buckets.
+ */
+class LatencyHistogram {
+  public:
+    LatencyHistogram();
+
+    /**
+     * Record a duration.
+     *
+     * @param duration The duration to record
+     */
+    void record(std::chrono::nanoseconds duration);
+
+    /**
+     * Clear all recorded durations. Durations recorded concurrently may be partially counted.
+     */
+    void reset();
+
+    /**
+     * Write the statistics to the given file descriptor using dprintf(), without ending newline.
+     *
+     * @param fd The file descriptor to write to
+     */
+    void dump(int fd) const;
+
+    /**
+     * Write the statistics to the given stream, without ending newline.
+     *
+     * @param stream The stream to write to
+     */
+    void dump(std::ostream& stream) const;
+
+  private:
+    // Bucket 0 is < 1us, bucket i is [2^(i-1), 2^i) us, the last one is everything above
+    static constexpr size_t kBucketCount = 32;
+
+    std::array<std::atomic<uint64_t>, kBucketCount> mBuckets;
+    std::atomic<uint64_t> mCount;
+    std::atomic<uint64_t> mTotalUs;
+    std::atomic<uint64_t> mMinUs;
+    std::atomic<uint64_t> mMaxUs;
+};
+
+}  // namespace stats
+}  // namespace hardware
+}  // namespace android
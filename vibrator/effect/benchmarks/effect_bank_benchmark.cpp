@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <aidl/android/hardware/vibrator/Effect.h>
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "effect_archive.h"
+#include "effect_bank.h"
+
+using aidl::android::hardware::vibrator::Effect;
+using aidl::android::hardware::vibrator::EffectStrength;
+
+namespace {
+
+// Unique effect ID and fifo data length of the streams shipped in the test directory
+struct TestEffect {
+    uint32_t uniqueEffectId;
+    size_t length;
+};
+
+const std::vector<TestEffect> kTestEffects = {
+        {static_cast<uint32_t>(Effect::CLICK), 2400},
+        {static_cast<uint32_t>(Effect::TICK), 1200},
+        {static_cast<uint32_t>(Effect::HEAVY_CLICK), 4800},
+        {EFFECT_ARCHIVE_PRIMITIVE_MASK | 1 /* CompositePrimitive::CLICK */, 2400},
+        {EFFECT_ARCHIVE_PRIMITIVE_MASK | 2 /* CompositePrimitive::THUD */, 7200},
+};
+
+// Never shipped nor composed, looking it up goes through the click fallback
+constexpr uint32_t kMissingEffectId = 1000;
+
+std::vector<char> fifoData(size_t length) {
+    std::vector<char> data(length);
+    for (size_t i = 0; i < length; i++) {
+        data[i] = static_cast<char>(i * 7);
+    }
+    return data;
+}
+
+void writeLooseFiles(const std::string& dir) {
+    for (const auto& effect : kTestEffects) {
+        const bool primitive = effect.uniqueEffectId & EFFECT_ARCHIVE_PRIMITIVE_MASK;
+        const uint32_t effectId = effect.uniqueEffectId & ~EFFECT_ARCHIVE_PRIMITIVE_MASK;
+        std::ofstream file(dir + (primitive ? "/primitive_effect_" : "/effect_") +
+                                   std::to_string(effectId) + ".bin",
+                           std::ios::binary);
+        const std::vector<char> data = fifoData(effect.length);
+        file.write(data.data(), data.size());
+    }
+}
+
+uint32_t align(uint32_t offset) {
+    const uint32_t mask = EFFECT_ARCHIVE_ALIGNMENT - 1;
+    return (offset + mask) & ~mask;
+}
+
+// Same layout as effect_packer
+void writeArchive(const std::string& dir) {
+    const effect_archive_header header = {
+            .magic = EFFECT_ARCHIVE_MAGIC,
+            .version = EFFECT_ARCHIVE_VERSION,
+            .count = static_cast<uint32_t>(kTestEffects.size()),
+            .reserved = 0,
+    };
+
+    std::ofstream file(dir + "/" EFFECT_ARCHIVE_NAME, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<effect_archive_entry> index;
+    uint32_t offset = align(sizeof(header) + kTestEffects.size() * sizeof(effect_archive_entry));
+    for (const auto& effect : kTestEffects) {
+        index.push_back({
+                .effect_id = effect.uniqueEffectId,
+                .offset = offset,
+                .length = static_cast<uint32_t>(effect.length),
+                .play_rate_hz = 24000,
+        });
+        offset = align(offset + effect.length);
+    }
+    file.write(reinterpret_cast<const char*>(index.data()),
+               index.size() * sizeof(effect_archive_entry));
+    for (size_t i = 0; i < kTestEffects.size(); i++) {
+        // Pad up to the aligned payload offset
+        file.seekp(index[i].offset);
+        const std::vector<char> data = fifoData(kTestEffects[i].length);
+        file.write(data.data(), data.size());
+    }
+}
+
+// Effect directory and bank shared by the warm lookup benchmarks
+class EffectBankFixture : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State& state) override {
+        if (state.thread_index() != 0) {
+            return;
+        }
+        mDir = std::make_unique<TemporaryDir>();
+        writeLooseFiles(mDir->path);
+        mBank = std::make_unique<EffectBank>(mDir->path);
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        if (state.thread_index() != 0) {
+            return;
+        }
+        mBank.reset();
+        mDir.reset();
+    }
+
+  protected:
+    std::unique_ptr<TemporaryDir> mDir;
+    std::unique_ptr<EffectBank> mBank;
+};
+
+}  // namespace
+
+// Building the bank and serving the first lookup, from loose files (0) or an archive (1)
+static void BM_EffectBank_ColdLookup(benchmark::State& state) {
+    TemporaryDir dir;
+    if (state.range(0)) {
+        writeArchive(dir.path);
+    } else {
+        writeLooseFiles(dir.path);
+    }
+
+    for (auto _ : state) {
+        EffectBank bank(dir.path);
+        benchmark::DoNotOptimize(bank.lookup(static_cast<uint32_t>(Effect::CLICK),
+                                             EffectStrength::MEDIUM));
+    }
+}
+BENCHMARK(BM_EffectBank_ColdLookup)->Arg(0)->Arg(1);
+
+BENCHMARK_DEFINE_F(EffectBankFixture, WarmLookup)(benchmark::State& state) {
+    const auto strength = static_cast<EffectStrength>(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mBank->lookup(static_cast<uint32_t>(Effect::TICK), strength));
+    }
+}
+BENCHMARK_REGISTER_F(EffectBankFixture, WarmLookup)
+        ->Arg(static_cast<int>(EffectStrength::LIGHT))
+        ->Arg(static_cast<int>(EffectStrength::STRONG));
+
+// Composed from primitives when the bank was built
+BENCHMARK_DEFINE_F(EffectBankFixture, ComposedLookup)(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                mBank->lookup(static_cast<uint32_t>(Effect::DOUBLE_CLICK), EffectStrength::STRONG));
+    }
+}
+BENCHMARK_REGISTER_F(EffectBankFixture, ComposedLookup);
+
+BENCHMARK_DEFINE_F(EffectBankFixture, FallbackLookup)(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mBank->lookup(kMissingEffectId, EffectStrength::MEDIUM));
+    }
+}
+BENCHMARK_REGISTER_F(EffectBankFixture, FallbackLookup);
+
+BENCHMARK_DEFINE_F(EffectBankFixture, ConcurrentLookup)(benchmark::State& state) {
+    uint32_t i = state.thread_index();
+    for (auto _ : state) {
+        const auto& effect = kTestEffects[i++ % kTestEffects.size()];
+        benchmark::DoNotOptimize(mBank->lookup(effect.uniqueEffectId, EffectStrength::LIGHT));
+    }
+}
+BENCHMARK_REGISTER_F(EffectBankFixture, ConcurrentLookup)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -34,96 +34,422 @@
 
 #define LOG_TAG "libqtivibratoreffect.xiaomi"
 
+#include <aidl/android/hardware/vibrator/CompositePrimitive.h>
 #include <aidl/android/hardware/vibrator/Effect.h>
+#include <aidl/android/hardware/vibrator/EffectStrength.h>
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <filesystem>
-#include <fstream>
-#include <iostream>
-#include <unordered_map>
+#include <map>
+#include <tuple>
 #include <vector>
 
 #include "effect.h"
+#include "effect_archive.h"
+#include "effect_bank.h"
+#include "effect_composer.h"
 
+using aidl::android::hardware::vibrator::CompositePrimitive;
 using aidl::android::hardware::vibrator::Effect;
+using aidl::android::hardware::vibrator::EffectStrength;
+using android::base::EndsWith;
+using android::base::GetUintProperty;
+using android::base::ParseUint;
+using android::base::StartsWith;
+using android::base::unique_fd;
 
 namespace {
 
 const uint32_t kDefaultPlayRateHz = 24000;
 const uint16_t kPrimitiveMask = (1 << 15);
 
-std::unordered_map<uint32_t, effect_stream> sEffectStreams;
-std::unordered_map<uint32_t, std::vector<int8_t>> sEffectFifoData;
+const std::string kEffectPrefix = "effect_";
+const std::string kPrimitiveEffectPrefix = "primitive_effect_";
+const std::string kEffectSuffix = ".bin";
 
-std::unique_ptr<effect_stream> readEffectStreamFromFile(uint32_t uniqueEffectId) {
-    std::filesystem::path filePath;
+static_assert(kPrimitiveMask == EFFECT_ARCHIVE_PRIMITIVE_MASK);
 
-    uint32_t effectId = uniqueEffectId & ~kPrimitiveMask;
+// Amplitude scale in Q8 applied to the fifo data for each effect strength
+struct StrengthScale {
+    EffectStrength strength;
+    int16_t scale;
+};
+
+const std::array<StrengthScale, 2> kStrengthScales = {{
+        {EffectStrength::LIGHT, 128},
+        {EffectStrength::MEDIUM, 192},
+}};
+
+// Upper bound for the fifo data of all the amplitude scaled effect streams
+const size_t kDefaultMaxScaledFifoBytes = 256 * 1024;
+const std::string kMaxScaledFifoBytesProp = "ro.vendor.vibrator.effect.max_scaled_bytes";
+
+constexpr uint32_t primitive(CompositePrimitive primitive) {
+    return kPrimitiveMask | static_cast<uint32_t>(primitive);
+}
+
+/*
+ * Recipes used to compose effects the device has no stream for, tried in
+ * order. Earlier recipes may build effects used by later ones.
+ */
+const std::vector<std::pair<Effect, EffectRecipe>> kEffectRecipes = {
+        {Effect::CLICK, {{primitive(CompositePrimitive::CLICK), 256, 0}}},
+        // Two clicks, two click lengths apart, like the original duplicated CLICK buffer
+        {Effect::DOUBLE_CLICK,
+         {{(uint32_t)Effect::CLICK, 256, 0}, {(uint32_t)Effect::CLICK, 256, 0, 2}}},
+        {Effect::TICK, {{primitive(CompositePrimitive::LIGHT_TICK), 256, 0}}},
+        {Effect::TICK, {{primitive(CompositePrimitive::CLICK), 128, 0}}},
+        {Effect::TEXTURE_TICK, {{primitive(CompositePrimitive::LOW_TICK), 256, 0}}},
+        {Effect::TEXTURE_TICK, {{primitive(CompositePrimitive::LIGHT_TICK), 128, 0}}},
+        {Effect::THUD, {{primitive(CompositePrimitive::THUD), 256, 0}}},
+        {Effect::POP, {{primitive(CompositePrimitive::QUICK_FALL), 256, 0}}},
+        {Effect::POP, {{primitive(CompositePrimitive::CLICK), 192, 0}}},
+        {Effect::HEAVY_CLICK,
+         {{primitive(CompositePrimitive::THUD), 192, 0},
+          {primitive(CompositePrimitive::CLICK), 256, 0}}},
+};
 
-    if ((uniqueEffectId & kPrimitiveMask) != 0) {
-        filePath = "/vendor/etc/vibrator/primitive_effect_" + std::to_string(effectId) + ".bin";
+bool parseEffectFileName(const std::string& fileName, uint32_t* uniqueEffectId) {
+    uint32_t mask;
+    std::string prefix;
+
+    if (StartsWith(fileName, kPrimitiveEffectPrefix)) {
+        prefix = kPrimitiveEffectPrefix;
+        mask = kPrimitiveMask;
+    } else if (StartsWith(fileName, kEffectPrefix)) {
+        prefix = kEffectPrefix;
+        mask = 0;
     } else {
-        filePath = "/vendor/etc/vibrator/effect_" + std::to_string(effectId) + ".bin";
+        return false;
     }
 
-    LOG(VERBOSE) << "Reading fifo data for effect " << effectId << " from " << filePath;
+    if (!EndsWith(fileName, kEffectSuffix)) {
+        return false;
+    }
+
+    std::string id = fileName.substr(prefix.size(),
+                                     fileName.size() - prefix.size() - kEffectSuffix.size());
+    uint32_t effectId;
+    if (!ParseUint(id, &effectId, static_cast<uint32_t>(kPrimitiveMask - 1))) {
+        return false;
+    }
+
+    *uniqueEffectId = effectId | mask;
+    return true;
+}
+
+}  // namespace
+
+const std::filesystem::path EffectBank::kDefaultEffectDir = "/vendor/etc/vibrator";
+
+EffectBank::EffectBank(const std::filesystem::path& effectDir)
+    : mEffectDir(effectDir),
+      mComposer([this](uint32_t uniqueEffectId) { return find(uniqueEffectId); }) {
+    auto start = std::chrono::steady_clock::now();
+
+    if (!loadArchive(mEffectDir / EFFECT_ARCHIVE_NAME)) {
+        loadEffectFiles();
+    }
+
+    std::sort(mEntries.begin(), mEntries.end(), [](const Entry& a, const Entry& b) {
+        return a.uniqueEffectId < b.uniqueEffectId;
+    });
+
+    composeMissingEffects();
+
+    renderScaledEffects();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    effect_memory_usage usage = getMemoryUsage();
+    LOG(INFO) << "Loaded " << mEntries.size() << " effect streams in " << elapsed.count()
+              << "us, mapped " << usage.mapped_bytes << " bytes, composed "
+              << usage.composed_bytes << " bytes, scaled " << usage.scaled_bytes << " bytes";
+}
+
+EffectBank::~EffectBank() {
+    for (const auto& mapping : mMappings) {
+        munmap(mapping.addr, mapping.length);
+    }
+}
 
-    std::ifstream data(filePath, std::ios::in | std::ios::binary);
-    if (!data.is_open()) {
-        LOG(ERROR) << "Failed to open " << filePath << " for effect " << effectId;
+const effect_stream* EffectBank::find(uint32_t uniqueEffectId) const {
+    auto it = std::lower_bound(
+            mEntries.begin(), mEntries.end(), uniqueEffectId,
+            [](const Entry& entry, uint32_t id) { return entry.uniqueEffectId < id; });
+    if (it == mEntries.end() || it->uniqueEffectId != uniqueEffectId) {
         return nullptr;
     }
 
-    std::uint32_t fileSize = std::filesystem::file_size(filePath);
+    return &it->stream;
+}
 
-    std::vector<int8_t> fifoData(fileSize);
-    data.read(reinterpret_cast<char*>(fifoData.data()), fileSize);
+const effect_stream* EffectBank::find(uint32_t uniqueEffectId, EffectStrength strength) const {
+    const effect_stream* effectStream = find(uniqueEffectId);
+    if (!effectStream || strength == EffectStrength::STRONG) {
+        return effectStream;
+    }
 
-    auto result = sEffectFifoData.emplace(uniqueEffectId, std::move(fifoData));
+    // Scaled entries are rendered in (unique effect ID, strength) order
+    auto it = std::lower_bound(mScaledEntries.begin(), mScaledEntries.end(),
+                               std::make_pair(uniqueEffectId, strength),
+                               [](const ScaledEntry& entry, const auto& key) {
+                                   return std::make_pair(entry.uniqueEffectId, entry.strength) <
+                                          key;
+                               });
+    if (it == mScaledEntries.end() || it->uniqueEffectId != uniqueEffectId ||
+        it->strength != strength) {
+        // Not rendered because of the memory bound, play it at full strength
+        return effectStream;
+    }
 
-    return std::make_unique<effect_stream>(effectId, fileSize, kDefaultPlayRateHz,
-                                           result.first->second.data());
+    return &it->stream;
 }
 
-std::unique_ptr<effect_stream> duplicateEffect(const effect_stream* effectStream,
-                                               uint32_t newEffectId) {
-    const std::uint32_t newEffectLength = effectStream->length * 4;
-    std::vector<int8_t> fifoData(newEffectLength);
+const int8_t* EffectBank::mapFile(const std::filesystem::path& filePath, size_t* length) {
+    unique_fd fd(TEMP_FAILURE_RETRY(open(filePath.c_str(), O_RDONLY | O_CLOEXEC)));
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            PLOG(ERROR) << "Failed to open " << filePath;
+        }
+        return nullptr;
+    }
 
-    std::copy(effectStream->data, effectStream->data + effectStream->length, fifoData.begin());
-    std::copy(effectStream->data, effectStream->data + effectStream->length,
-              fifoData.begin() + newEffectLength - effectStream->length);
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        PLOG(ERROR) << "Failed to stat " << filePath;
+        return nullptr;
+    }
 
-    auto result = sEffectFifoData.emplace(newEffectId, std::move(fifoData));
+    if (st.st_size <= 0 || st.st_size > UINT32_MAX) {
+        LOG(ERROR) << "Invalid size " << st.st_size << " for " << filePath;
+        return nullptr;
+    }
 
-    return std::make_unique<effect_stream>(newEffectId, newEffectLength, kDefaultPlayRateHz,
-                                           result.first->second.data());
+    // Prefault the pages so that the first play does not take page faults
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        PLOG(ERROR) << "Failed to mmap " << filePath;
+        return nullptr;
+    }
+
+    mMappings.push_back({addr, static_cast<size_t>(st.st_size)});
+
+    *length = st.st_size;
+    return static_cast<const int8_t*>(addr);
 }
 
-}  // namespace
+void EffectBank::unmapFile(const int8_t* data) {
+    auto it = std::find_if(mMappings.begin(), mMappings.end(),
+                           [data](const Mapping& mapping) { return mapping.addr == data; });
+    if (it == mMappings.end()) {
+        return;
+    }
 
-const struct effect_stream* get_effect_stream(uint32_t effectId) {
-    auto it = sEffectStreams.find(effectId);
-    if (it == sEffectStreams.end()) {
-        std::unique_ptr<effect_stream> newEffectStream = readEffectStreamFromFile(effectId);
-
-        if (newEffectStream) {
-            auto result = sEffectStreams.emplace(effectId, *newEffectStream);
-            return &result.first->second;
-        } else if (effectId == (uint32_t)Effect::DOUBLE_CLICK) {
-            LOG(VERBOSE) << "Could not get double click effect, duplicating click effect";
-            newEffectStream = duplicateEffect(get_effect_stream((uint32_t)Effect::CLICK),
-                                              (uint32_t)Effect::DOUBLE_CLICK);
-            if (newEffectStream) {
-                auto result = sEffectStreams.emplace(effectId, *newEffectStream);
-                return &result.first->second;
+    munmap(it->addr, it->length);
+    mMappings.erase(it);
+}
+
+bool EffectBank::loadArchive(const std::filesystem::path& filePath) {
+    size_t length;
+    const int8_t* archive = mapFile(filePath, &length);
+    if (!archive) {
+        return false;
+    }
+
+    LOG(VERBOSE) << "Reading fifo data for all effects from " << filePath;
+
+    const auto* header = reinterpret_cast<const effect_archive_header*>(archive);
+    if (length < sizeof(*header) || header->magic != EFFECT_ARCHIVE_MAGIC ||
+        header->version != EFFECT_ARCHIVE_VERSION) {
+        LOG(ERROR) << "Invalid effect archive header in " << filePath;
+        unmapFile(archive);
+        return false;
+    }
+
+    if (header->count > (length - sizeof(*header)) / sizeof(effect_archive_entry)) {
+        LOG(ERROR) << "Truncated effect archive index in " << filePath;
+        unmapFile(archive);
+        return false;
+    }
+
+    const auto* index = reinterpret_cast<const effect_archive_entry*>(header + 1);
+    const size_t firstEntry = mEntries.size();
+    for (uint32_t i = 0; i < header->count; i++) {
+        const effect_archive_entry& entry = index[i];
+
+        // Lookups rely on unique IDs, don't guess which of the duplicates is meant
+        if (i > 0 && entry.effect_id <= index[i - 1].effect_id) {
+            LOG(ERROR) << "Unsorted or duplicate effect " << entry.effect_id << " in " << filePath;
+            mEntries.erase(mEntries.begin() + firstEntry, mEntries.end());
+            unmapFile(archive);
+            return false;
+        }
+
+        if (entry.length == 0 || entry.offset % EFFECT_ARCHIVE_ALIGNMENT != 0 ||
+            entry.offset > length || entry.length > length - entry.offset) {
+            LOG(ERROR) << "Invalid archive entry for effect " << entry.effect_id << " in "
+                       << filePath;
+            continue;
+        }
+
+        uint32_t effectId = entry.effect_id & ~kPrimitiveMask;
+        mEntries.push_back({entry.effect_id,
+                            effect_stream(effectId, entry.length,
+                                          entry.play_rate_hz ? entry.play_rate_hz
+                                                             : kDefaultPlayRateHz,
+                                          archive + entry.offset)});
+    }
+
+    return true;
+}
+
+void EffectBank::loadEffectFiles() {
+    std::error_code ec;
+    for (const auto& dirEntry : std::filesystem::directory_iterator(mEffectDir, ec)) {
+        uint32_t uniqueEffectId;
+        if (!parseEffectFileName(dirEntry.path().filename(), &uniqueEffectId)) {
+            continue;
+        }
+        loadEffectFile(uniqueEffectId, dirEntry.path());
+    }
+    if (ec) {
+        LOG(ERROR) << "Failed to scan " << mEffectDir << ": " << ec.message();
+    }
+}
+
+void EffectBank::loadEffectFile(uint32_t uniqueEffectId, const std::filesystem::path& filePath) {
+    uint32_t effectId = uniqueEffectId & ~kPrimitiveMask;
+
+    LOG(VERBOSE) << "Reading fifo data for effect " << effectId << " from " << filePath;
+
+    size_t length;
+    const int8_t* data = mapFile(filePath, &length);
+    if (!data) {
+        LOG(ERROR) << "Failed to load " << filePath << " for effect " << effectId;
+        return;
+    }
+
+    mEntries.push_back({uniqueEffectId, effect_stream(effectId, length, kDefaultPlayRateHz, data)});
+}
+
+void EffectBank::composeMissingEffects() {
+    for (const auto& [effect, recipe] : kEffectRecipes) {
+        uint32_t effectId = static_cast<uint32_t>(effect);
+        if (find(effectId)) {
+            continue;
+        }
+
+        std::optional<effect_stream> effectStream = mComposer.compose(effectId, recipe);
+        if (!effectStream) {
+            continue;
+        }
+
+        LOG(VERBOSE) << "Could not get effect " << effectId << ", composed it from "
+                     << recipe.size() << " steps";
+
+        Entry entry = {effectId, *effectStream};
+        mEntries.insert(std::upper_bound(mEntries.begin(), mEntries.end(), entry,
+                                         [](const Entry& a, const Entry& b) {
+                                             return a.uniqueEffectId < b.uniqueEffectId;
+                                         }),
+                        entry);
+    }
+}
+
+effect_memory_usage EffectBank::getMemoryUsage() const {
+    effect_memory_usage usage = {};
+
+    for (const auto& mapping : mMappings) {
+        usage.mapped_bytes += mapping.length;
+    }
+    usage.composed_bytes = mComposer.getTotalBytes();
+    usage.scaled_bytes = mScaledBytes;
+
+    return usage;
+}
+
+void EffectBank::renderScaledEffects() {
+    const size_t maxScaledBytes =
+            GetUintProperty<size_t>(kMaxScaledFifoBytesProp, kDefaultMaxScaledFifoBytes);
+
+    // Effects sharing a stream, like composed aliases, share its scaled copies too
+    std::map<std::tuple<const int8_t*, uint32_t, EffectStrength>, const int8_t*> rendered;
+
+    // Entries are sorted by unique effect ID, so effects come before primitives
+    for (const auto& entry : mEntries) {
+        if (entry.uniqueEffectId & kPrimitiveMask) {
+            // Primitives are scaled by the composition, they never take an EffectStrength
+            break;
+        }
+
+        for (const auto& [strength, scale] : kStrengthScales) {
+            const auto key = std::make_tuple(entry.stream.data, entry.stream.length, strength);
+            auto it = rendered.find(key);
+            if (it == rendered.end()) {
+                if (mScaledBytes + entry.stream.length > maxScaledBytes) {
+                    LOG(WARNING) << "Scaled effect streams exceed " << maxScaledBytes
+                                 << " bytes, remaining effects play at full strength";
+                    return;
+                }
+
+                std::vector<int8_t>& fifoData = mOwnedFifoData.emplace_back(entry.stream.length);
+                scaleFifoData(entry.stream.data, fifoData.data(), entry.stream.length, scale);
+                mScaledBytes += entry.stream.length;
+                it = rendered.emplace(key, fifoData.data()).first;
             }
-        } else if (effectId != (uint32_t)Effect::CLICK) {
-            LOG(VERBOSE) << "Could not get effect " << effectId << ", falling back to click effect";
-            return get_effect_stream((uint32_t)Effect::CLICK);
+
+            mScaledEntries.push_back({entry.uniqueEffectId, strength,
+                                      effect_stream(entry.stream.effect_id, entry.stream.length,
+                                                    entry.stream.play_rate_hz, it->second)});
         }
-    } else {
-        return &it->second;
+    }
+}
+
+const effect_stream* EffectBank::lookup(uint32_t effectId, EffectStrength strength) const {
+    const effect_stream* effectStream = find(effectId, strength);
+    if (effectStream) {
+        return effectStream;
+    }
+
+    if (effectId != (uint32_t)Effect::CLICK) {
+        LOG(VERBOSE) << "Could not get effect " << effectId << ", falling back to click effect";
+        return find((uint32_t)Effect::CLICK, strength);
     }
 
     return nullptr;
 }
+
+namespace {
+
+const EffectBank& getEffectBank() {
+    // Built exactly once, lookups afterwards only read immutable data
+    static const EffectBank sEffectBank;
+    return sEffectBank;
+}
+
+// Build the effect bank when the library is loaded rather than on the first haptic
+[[maybe_unused]] const EffectBank& sPrewarmedEffectBank = getEffectBank();
+
+}  // namespace
+
+const struct effect_stream* get_effect_stream(uint32_t effectId) {
+    return get_effect_stream(effectId, EffectStrength::STRONG);
+}
+
+const struct effect_stream* get_effect_stream(uint32_t effectId, EffectStrength strength) {
+    return getEffectBank().lookup(effectId, strength);
+}
+
+void get_effect_memory_usage(struct effect_memory_usage* usage) {
+    *usage = getEffectBank().getMemoryUsage();
+}
@@ -30,6 +30,7 @@
 
 #ifndef QTI_VIBRATOR_EFFECT_STREAM_H
 #define QTI_VIBRATOR_EFFECT_STREAM_H
+#include <aidl/android/hardware/vibrator/EffectStrength.h>
 #include <sys/types.h>
 
 struct effect_stream {
@@ -42,6 +43,32 @@ struct effect_stream {
         : effect_id(effect_id), length(length), play_rate_hz(play_rate_hz), data(data) {}
 };
 
+/*
+ * Look up the effect stream for effect_id. Safe to call from any thread, the
+ * returned pointer stays valid for the lifetime of the process.
+ */
 const struct effect_stream* get_effect_stream(uint32_t effect_id);
 
+/*
+ * Same as get_effect_stream(effect_id), with the fifo data amplitude scaled for
+ * the given strength. EffectStrength::STRONG returns the unscaled stream.
+ */
+const struct effect_stream* get_effect_stream(
+        uint32_t effect_id, ::aidl::android::hardware::vibrator::EffectStrength strength);
+
+struct effect_memory_usage {
+    /* Effect files or archive mapped from /vendor/etc/vibrator */
+    size_t mapped_bytes;
+    /* Effects composed from other effects or primitives */
+    size_t composed_bytes;
+    /* Amplitude scaled copies for the lighter effect strengths */
+    size_t scaled_bytes;
+};
+
+/*
+ * Report the memory held by the fifo data of all effect streams. The scaled
+ * copies can be bounded with ro.vendor.vibrator.effect.max_scaled_bytes.
+ */
+void get_effect_memory_usage(struct effect_memory_usage* usage);
+
 #endif
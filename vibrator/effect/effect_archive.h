@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef QTI_VIBRATOR_EFFECT_ARCHIVE_H
+#define QTI_VIBRATOR_EFFECT_ARCHIVE_H
+
+#include <stdint.h>
+
+/*
+ * Packed vibrator effect archive.
+ *
+ * Layout (all fields little endian):
+ *   effect_archive_header
+ *   effect_archive_entry[count], sorted by ascending effect_id
+ *   payloads, each starting at a multiple of EFFECT_ARCHIVE_ALIGNMENT
+ *
+ * effect_id uses the same encoding as get_effect_stream(), primitive effects
+ * have EFFECT_ARCHIVE_PRIMITIVE_MASK set. Offsets are relative to the start of
+ * the archive so the whole file can be used in place through a single mmap.
+ */
+
+#define EFFECT_ARCHIVE_MAGIC 0x41584656 /* "VFXA" */
+#define EFFECT_ARCHIVE_VERSION 1
+#define EFFECT_ARCHIVE_ALIGNMENT 64
+#define EFFECT_ARCHIVE_PRIMITIVE_MASK (1 << 15)
+
+/* Looked up next to the loose effect files, i.e. /vendor/etc/vibrator */
+#define EFFECT_ARCHIVE_NAME "effects.bin"
+
+struct effect_archive_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct effect_archive_entry {
+    uint32_t effect_id;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t play_rate_hz;
+};
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <aidl/android/hardware/vibrator/EffectStrength.h>
+#include <filesystem>
+#include <list>
+#include <vector>
+
+#include "effect.h"
+#include "effect_composer.h"
+
+/*
+ * Immutable table of every effect stream available on the device.
+ *
+ * The packed effect archive, or when there is none all loose effect and
+ * primitive files, are mapped once when the table is built, so lookups never
+ * touch the filesystem and never take a lock. Entries are sorted by unique
+ * effect ID and never modified afterwards, which keeps the returned
+ * effect_stream pointers valid for the lifetime of the bank.
+ *
+ * Effects without a stream of their own are composed from built-in recipes,
+ * and amplitude scaled copies for the lighter effect strengths are rendered at
+ * the same time, up to ro.vendor.vibrator.effect.max_scaled_bytes bytes.
+ */
+class EffectBank {
+  public:
+    using EffectStrength = ::aidl::android::hardware::vibrator::EffectStrength;
+
+    static const std::filesystem::path kDefaultEffectDir;
+
+    /**
+     * Constructor.
+     *
+     * @param effectDir The directory holding the effect archive or the loose effect files
+     */
+    explicit EffectBank(const std::filesystem::path& effectDir = kDefaultEffectDir);
+    ~EffectBank();
+
+    EffectBank(const EffectBank&) = delete;
+    EffectBank& operator=(const EffectBank&) = delete;
+
+    const effect_stream* find(uint32_t uniqueEffectId) const;
+    const effect_stream* find(uint32_t uniqueEffectId, EffectStrength strength) const;
+
+    /**
+     * Same as find(), falling back to the click effect for other missing effects, as
+     * get_effect_stream() does.
+     */
+    const effect_stream* lookup(uint32_t effectId, EffectStrength strength) const;
+
+    effect_memory_usage getMemoryUsage() const;
+
+  private:
+    struct Entry {
+        uint32_t uniqueEffectId;
+        effect_stream stream;
+    };
+
+    struct ScaledEntry {
+        uint32_t uniqueEffectId;
+        EffectStrength strength;
+        effect_stream stream;
+    };
+
+    struct Mapping {
+        void* addr;
+        size_t length;
+    };
+
+    const int8_t* mapFile(const std::filesystem::path& filePath, size_t* length);
+    void unmapFile(const int8_t* data);
+    bool loadArchive(const std::filesystem::path& filePath);
+    void loadEffectFiles();
+    void loadEffectFile(uint32_t uniqueEffectId, const std::filesystem::path& filePath);
+    void composeMissingEffects();
+    void renderScaledEffects();
+
+    const std::filesystem::path mEffectDir;
+    std::vector<Entry> mEntries;
+    std::vector<ScaledEntry> mScaledEntries;
+    std::vector<Mapping> mMappings;
+    std::list<std::vector<int8_t>> mOwnedFifoData;
+    EffectComposer mComposer;
+    size_t mScaledBytes = 0;
+};
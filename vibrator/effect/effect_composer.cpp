@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "libqtivibratoreffect.xiaomi"
+
+#include "effect_composer.h"
+
+#include <android-base/logging.h>
+#include <algorithm>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+void scaleFifoData(const int8_t* in, int8_t* out, size_t length, int16_t scale) {
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 16 <= length; i += 16) {
+        int8x16_t data = vld1q_s8(in + i);
+        int16x8_t lo = vmulq_n_s16(vmovl_s8(vget_low_s8(data)), scale);
+        int16x8_t hi = vmulq_n_s16(vmovl_s8(vget_high_s8(data)), scale);
+        vst1q_s8(out + i, vcombine_s8(vqrshrn_n_s16(lo, 8), vqrshrn_n_s16(hi, 8)));
+    }
+#endif
+
+    for (; i < length; i++) {
+        int32_t value = (in[i] * scale + 128) >> 8;
+        out[i] = std::clamp<int32_t>(value, INT8_MIN, INT8_MAX);
+    }
+}
+
+EffectComposer::EffectComposer(Lookup lookup) : mLookup(lookup) {}
+
+std::optional<effect_stream> EffectComposer::compose(uint32_t effectId,
+                                                     const EffectRecipe& recipe) {
+    auto it = mCache.find(recipe);
+    if (it != mCache.end()) {
+        return effect_stream(effectId, it->second.fifoData.size(), it->second.playRateHz,
+                             it->second.fifoData.data());
+    }
+
+    if (recipe.empty()) {
+        return std::nullopt;
+    }
+
+    std::vector<const effect_stream*> sources;
+    for (const auto& step : recipe) {
+        const effect_stream* source = mLookup(step.effectId);
+        if (!source) {
+            return std::nullopt;
+        }
+        if (step.scale < 0 || step.scale > 256) {
+            LOG(ERROR) << "Invalid scale " << step.scale << " for effect " << effectId;
+            return std::nullopt;
+        }
+        if (!sources.empty() && source->play_rate_hz != sources.front()->play_rate_hz) {
+            LOG(ERROR) << "Mismatching play rates in recipe for effect " << effectId;
+            return std::nullopt;
+        }
+        sources.push_back(source);
+    }
+
+    const uint32_t playRateHz = sources.front()->play_rate_hz;
+
+    size_t length = 0;
+    for (size_t i = 0; i < recipe.size(); i++) {
+        length += static_cast<size_t>(recipe[i].delayMs) * playRateHz / 1000;
+        length += static_cast<size_t>(recipe[i].delayLengths + 1) * sources[i]->length;
+    }
+
+    Rendered rendered = {playRateHz, std::vector<int8_t>(length)};
+
+    // The buffer is zero initialized, so delays only need to be skipped
+    int8_t* out = rendered.fifoData.data();
+    for (size_t i = 0; i < recipe.size(); i++) {
+        out += static_cast<size_t>(recipe[i].delayMs) * playRateHz / 1000;
+        out += static_cast<size_t>(recipe[i].delayLengths) * sources[i]->length;
+        scaleFifoData(sources[i]->data, out, sources[i]->length, recipe[i].scale);
+        out += sources[i]->length;
+    }
+
+    it = mCache.emplace(recipe, std::move(rendered)).first;
+
+    LOG(VERBOSE) << "Composed effect " << effectId << " from " << recipe.size() << " steps, "
+                 << length << " bytes";
+
+    return effect_stream(effectId, it->second.fifoData.size(), it->second.playRateHz,
+                         it->second.fifoData.data());
+}
+
+size_t EffectComposer::getTotalBytes() const {
+    size_t total = 0;
+    for (const auto& [recipe, rendered] : mCache) {
+        total += rendered.fifoData.size();
+    }
+    return total;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+#include "effect.h"
+
+/*
+ * Scale fifo data by scale / 256 with rounding, saturating to the int8 range.
+ * scale must not exceed 256 so that the intermediate products fit in int16.
+ */
+void scaleFifoData(const int8_t* in, int8_t* out, size_t length, int16_t scale);
+
+/*
+ * One step of an effect recipe: silence for delayMs plus delayLengths times the
+ * length of effectId's stream, followed by the fifo data of effectId amplitude
+ * scaled by scale / 256.
+ */
+struct EffectRecipeStep {
+    uint32_t effectId;
+    int16_t scale;
+    uint16_t delayMs;
+    uint16_t delayLengths = 0;
+
+    bool operator<(const EffectRecipeStep& other) const {
+        return std::tie(effectId, scale, delayMs, delayLengths) <
+               std::tie(other.effectId, other.scale, other.delayMs, other.delayLengths);
+    }
+};
+
+using EffectRecipe = std::vector<EffectRecipeStep>;
+
+/*
+ * Builds effect streams out of other effect streams, usually primitives.
+ *
+ * Each recipe is rendered once and kept for the lifetime of the composer, so
+ * composing the same recipe again, even for another effect, reuses the same
+ * fifo data and playing a composed effect never allocates.
+ */
+class EffectComposer {
+  public:
+    using Lookup = std::function<const effect_stream*(uint32_t effectId)>;
+
+    /**
+     * Constructor.
+     *
+     * @param lookup Returns the stream for an effect ID used in recipes, or nullptr
+     */
+    EffectComposer(Lookup lookup);
+
+    /**
+     * Compose an effect stream following the given recipe.
+     *
+     * @param effectId The effect ID of the returned stream
+     * @param recipe The steps to render
+     * @return The composed stream, or std::nullopt if a step's effect is missing or the
+     *         steps don't share the same play rate
+     */
+    std::optional<effect_stream> compose(uint32_t effectId, const EffectRecipe& recipe);
+
+    /**
+     * Get the number of fifo data bytes held by rendered recipes.
+     */
+    size_t getTotalBytes() const;
+
+  private:
+    struct Rendered {
+        uint32_t playRateHz;
+        std::vector<int8_t> fifoData;
+    };
+
+    Lookup mLookup;
+    std::map<EffectRecipe, Rendered> mCache;
+};
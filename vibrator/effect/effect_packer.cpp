@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host tool packing the loose effect_<id>.bin and primitive_effect_<id>.bin
+ * files of a device into a single effect archive, see effect_archive.h.
+ *
+ * Usage: vibrator_effect_packer [-r play_rate_hz] <input dir> <output file>
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "effect_archive.h"
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "effect archives are little endian");
+
+namespace {
+
+const uint32_t kDefaultPlayRateHz = 24000;
+
+struct Effect {
+    uint32_t id;
+    std::vector<char> data;
+};
+
+bool parseEffectId(const std::string& fileName, uint32_t* id) {
+    static const std::string kPrimitivePrefix = "primitive_effect_";
+    static const std::string kPrefix = "effect_";
+    static const std::string kSuffix = ".bin";
+
+    uint32_t mask = 0;
+    std::string prefix = kPrefix;
+    if (fileName.rfind(kPrimitivePrefix, 0) == 0) {
+        prefix = kPrimitivePrefix;
+        mask = EFFECT_ARCHIVE_PRIMITIVE_MASK;
+    } else if (fileName.rfind(kPrefix, 0) != 0) {
+        return false;
+    }
+
+    if (fileName.size() <= prefix.size() + kSuffix.size() ||
+        fileName.compare(fileName.size() - kSuffix.size(), kSuffix.size(), kSuffix) != 0) {
+        return false;
+    }
+
+    std::string digits =
+            fileName.substr(prefix.size(), fileName.size() - prefix.size() - kSuffix.size());
+    if (digits.find_first_not_of("0123456789") != std::string::npos || digits.size() > 5) {
+        return false;
+    }
+
+    unsigned long value = std::stoul(digits);
+    if (value >= EFFECT_ARCHIVE_PRIMITIVE_MASK) {
+        return false;
+    }
+
+    *id = value | mask;
+    return true;
+}
+
+uint64_t align(uint64_t offset) {
+    const uint64_t mask = EFFECT_ARCHIVE_ALIGNMENT - 1;
+    return (offset + mask) & ~mask;
+}
+
+void usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-r play_rate_hz] <input dir> <output file>\n", name);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    uint32_t playRateHz = kDefaultPlayRateHz;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        switch (opt) {
+            case 'r':
+                playRateHz = strtoul(optarg, nullptr, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - optind != 2 || playRateHz == 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path inputDir = argv[optind];
+    const std::filesystem::path outputFile = argv[optind + 1];
+
+    std::vector<Effect> effects;
+    std::error_code ec;
+    for (const auto& dirEntry : std::filesystem::directory_iterator(inputDir, ec)) {
+        uint32_t id;
+        if (!dirEntry.is_regular_file() || !parseEffectId(dirEntry.path().filename(), &id)) {
+            continue;
+        }
+
+        std::ifstream file(dirEntry.path(), std::ios::in | std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+        if (!file.good() && !file.eof()) {
+            fprintf(stderr, "Failed to read %s\n", dirEntry.path().c_str());
+            return EXIT_FAILURE;
+        }
+        if (data.empty()) {
+            fprintf(stderr, "Skipping empty %s\n", dirEntry.path().c_str());
+            continue;
+        }
+
+        effects.push_back({id, std::move(data)});
+    }
+    if (ec) {
+        fprintf(stderr, "Failed to scan %s: %s\n", inputDir.c_str(), ec.message().c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::sort(effects.begin(), effects.end(),
+              [](const Effect& a, const Effect& b) { return a.id < b.id; });
+
+    effect_archive_header header = {
+            .magic = EFFECT_ARCHIVE_MAGIC,
+            .version = EFFECT_ARCHIVE_VERSION,
+            .count = static_cast<uint32_t>(effects.size()),
+            .reserved = 0,
+    };
+
+    std::vector<effect_archive_entry> index;
+    uint64_t offset = align(sizeof(header) + effects.size() * sizeof(effect_archive_entry));
+    for (const auto& effect : effects) {
+        if (offset + effect.data.size() > UINT32_MAX) {
+            fprintf(stderr, "Effect archive too large\n");
+            return EXIT_FAILURE;
+        }
+
+        index.push_back({
+                .effect_id = effect.id,
+                .offset = static_cast<uint32_t>(offset),
+                .length = static_cast<uint32_t>(effect.data.size()),
+                .play_rate_hz = playRateHz,
+        });
+        offset = align(offset + effect.data.size());
+    }
+
+    std::ofstream output(outputFile, std::ios::out | std::ios::binary | std::ios::trunc);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(index.data()),
+                 index.size() * sizeof(effect_archive_entry));
+    for (size_t i = 0; i < effects.size(); i++) {
+        // Pad up to the aligned payload offset
+        output.seekp(index[i].offset);
+        output.write(effects[i].data.data(), effects[i].data.size());
+    }
+    if (!output.good()) {
+        fprintf(stderr, "Failed to write %s\n", outputFile.c_str());
+        return EXIT_FAILURE;
+    }
+
+    printf("Packed %zu effects into %s\n", effects.size(), outputFile.c_str());
+    return EXIT_SUCCESS;
+}
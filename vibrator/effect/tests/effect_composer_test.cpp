@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+
+#include "effect_composer.h"
+
+namespace {
+
+constexpr uint32_t kPlayRateHz = 24000;
+constexpr uint32_t kSamplesPerMs = kPlayRateHz / 1000;
+
+constexpr uint32_t kClick = 1;
+constexpr uint32_t kTick = 2;
+constexpr uint32_t kSlowClick = 3;
+constexpr uint32_t kMissing = 4;
+
+class EffectComposerTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        addStream(kClick, {100, -100, 64, -64}, kPlayRateHz);
+        addStream(kTick, {10, 20}, kPlayRateHz);
+        addStream(kSlowClick, {100, -100}, kPlayRateHz / 2);
+    }
+
+    void addStream(uint32_t effectId, std::vector<int8_t> data, uint32_t playRateHz) {
+        std::vector<int8_t>& owned = mData[effectId] = std::move(data);
+        mStreams.emplace(effectId, effect_stream(effectId, owned.size(), playRateHz, owned.data()));
+    }
+
+    const effect_stream* lookup(uint32_t effectId) {
+        mLookupCount++;
+        auto it = mStreams.find(effectId);
+        return it != mStreams.end() ? &it->second : nullptr;
+    }
+
+    std::vector<int8_t> fifoData(const effect_stream& stream) {
+        return std::vector<int8_t>(stream.data, stream.data + stream.length);
+    }
+
+    std::map<uint32_t, std::vector<int8_t>> mData;
+    std::map<uint32_t, effect_stream> mStreams;
+    size_t mLookupCount = 0;
+    EffectComposer mComposer{[this](uint32_t effectId) { return lookup(effectId); }};
+};
+
+TEST_F(EffectComposerTest, ComposesSingleStep) {
+    auto stream = mComposer.compose(100, {{kClick, 256, 0}});
+    ASSERT_TRUE(stream);
+
+    EXPECT_EQ(stream->effect_id, 100u);
+    EXPECT_EQ(stream->play_rate_hz, kPlayRateHz);
+    EXPECT_EQ(fifoData(*stream), mData[kClick]);
+}
+
+TEST_F(EffectComposerTest, CachesRecipes) {
+    const EffectRecipe recipe = {{kClick, 256, 0}, {kTick, 256, 10}};
+
+    auto first = mComposer.compose(100, recipe);
+    ASSERT_TRUE(first);
+    const size_t lookups = mLookupCount;
+    const size_t totalBytes = mComposer.getTotalBytes();
+
+    // The same recipe for another effect reuses the rendered fifo data
+    auto second = mComposer.compose(101, recipe);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(second->effect_id, 101u);
+    EXPECT_EQ(second->data, first->data);
+    EXPECT_EQ(mLookupCount, lookups);
+    EXPECT_EQ(mComposer.getTotalBytes(), totalBytes);
+
+    auto other = mComposer.compose(102, {{kTick, 256, 0}});
+    ASSERT_TRUE(other);
+    EXPECT_NE(other->data, first->data);
+    EXPECT_EQ(mComposer.getTotalBytes(), totalBytes + mData[kTick].size());
+}
+
+TEST_F(EffectComposerTest, InsertsSilenceForDelays) {
+    auto stream = mComposer.compose(100, {{kTick, 256, 2}, {kTick, 256, 1}});
+    ASSERT_TRUE(stream);
+
+    std::vector<int8_t> expected(2 * kSamplesPerMs, 0);
+    expected.insert(expected.end(), mData[kTick].begin(), mData[kTick].end());
+    expected.insert(expected.end(), kSamplesPerMs, 0);
+    expected.insert(expected.end(), mData[kTick].begin(), mData[kTick].end());
+    EXPECT_EQ(fifoData(*stream), expected);
+}
+
+TEST_F(EffectComposerTest, InsertsSilenceForStreamLengths) {
+    // Both clicks at the ends of a buffer four clicks long
+    auto stream = mComposer.compose(100, {{kClick, 256, 0}, {kClick, 256, 0, 2}});
+    ASSERT_TRUE(stream);
+
+    std::vector<int8_t> expected = mData[kClick];
+    expected.insert(expected.end(), 2 * mData[kClick].size(), 0);
+    expected.insert(expected.end(), mData[kClick].begin(), mData[kClick].end());
+    EXPECT_EQ(fifoData(*stream), expected);
+
+    // Cached apart from the same steps without the delay
+    auto adjacent = mComposer.compose(101, {{kClick, 256, 0}, {kClick, 256, 0}});
+    ASSERT_TRUE(adjacent);
+    EXPECT_EQ(adjacent->length, 2 * mData[kClick].size());
+}
+
+TEST_F(EffectComposerTest, ScalesAmplitude) {
+    auto half = mComposer.compose(100, {{kClick, 128, 0}});
+    ASSERT_TRUE(half);
+    EXPECT_EQ(fifoData(*half), std::vector<int8_t>({50, -50, 32, -32}));
+
+    auto silent = mComposer.compose(101, {{kClick, 0, 0}});
+    ASSERT_TRUE(silent);
+    EXPECT_EQ(fifoData(*silent), std::vector<int8_t>(4, 0));
+
+    EXPECT_FALSE(mComposer.compose(102, {{kClick, 257, 0}}));
+    EXPECT_FALSE(mComposer.compose(103, {{kClick, -1, 0}}));
+}
+
+TEST_F(EffectComposerTest, RejectsMismatchingPlayRates) {
+    EXPECT_FALSE(mComposer.compose(100, {{kClick, 256, 0}, {kSlowClick, 256, 0}}));
+    EXPECT_EQ(mComposer.getTotalBytes(), 0u);
+
+    auto slow = mComposer.compose(101, {{kSlowClick, 256, 0}, {kSlowClick, 256, 0}});
+    ASSERT_TRUE(slow);
+    EXPECT_EQ(slow->play_rate_hz, kPlayRateHz / 2);
+}
+
+TEST_F(EffectComposerTest, RejectsMissingEffects) {
+    EXPECT_FALSE(mComposer.compose(100, {{kClick, 256, 0}, {kMissing, 256, 0}}));
+    EXPECT_FALSE(mComposer.compose(101, {}));
+    EXPECT_EQ(mComposer.getTotalBytes(), 0u);
+}
+
+TEST(ScaleFifoDataTest, MatchesScalarRounding) {
+    // Long enough to go through the vectorized path where there is one
+    std::vector<int8_t> in(37);
+    for (size_t i = 0; i < in.size(); i++) {
+        in[i] = static_cast<int8_t>(i % 2 ? INT8_MIN + i : INT8_MAX - i);
+    }
+    std::vector<int8_t> out(in.size());
+
+    scaleFifoData(in.data(), out.data(), in.size(), 256);
+    EXPECT_EQ(out, in);
+
+    scaleFifoData(in.data(), out.data(), in.size(), 192);
+    for (size_t i = 0; i < in.size(); i++) {
+        EXPECT_EQ(out[i], (in[i] * 192 + 128) >> 8) << "at " << i;
+    }
+}
+
+}  // namespace